@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Binds a host opcode to the command struct carried as its payload.
+template<uint8_t Opcode, typename T>
+struct Cmd {
+	static_assert(std::is_trivially_copyable<T>::value,
+			"Command payloads are copied straight out of the receive buffer");
+	static_assert(std::is_default_constructible<T>::value,
+			"Commands are decoded into a default constructed instance");
+
+	static constexpr uint8_t OPCODE = Opcode;
+	// Commands without a payload are empty structs, which still have a sizeof of 1.
+	static constexpr size_t PAYLOAD_SIZE = std::is_empty<T>::value ? 0 : sizeof(T);
+
+	static void decode_and_execute(const uint8_t *payload) {
+		T cmd;
+		std::memcpy(&cmd, payload, PAYLOAD_SIZE);
+		cmd.execute();
+	}
+};
+
+// Compile-time registry of host commands: builds a 256-entry table indexed by opcode, so that dispatching is a
+// single indexed call and payload sizes come from the command structs themselves.
+template<typename ... Cmds>
+class CommandTable {
+public:
+	struct Entry {
+		void (*decode_and_execute)(const uint8_t *payload);  // nullptr for unknown opcodes.
+		size_t payload_size;
+	};
+
+	static constexpr size_t MAX_PAYLOAD_SIZE = std::max( { size_t(1),
+			Cmds::PAYLOAD_SIZE... });
+
+	static const Entry& lookup(uint8_t opcode) {
+		return TABLE[opcode];
+	}
+
+private:
+	static constexpr bool unique_opcodes() {
+		const uint8_t opcodes[] = { Cmds::OPCODE... };
+		for (size_t i = 0; i < sizeof...(Cmds); ++i) {
+			for (size_t j = i + 1; j < sizeof...(Cmds); ++j) {
+				if (opcodes[i] == opcodes[j])
+					return false;
+			}
+		}
+		return true;
+	}
+	static_assert(sizeof...(Cmds) > 0, "CommandTable needs at least one command");
+	static_assert(unique_opcodes(), "Each opcode can only be bound to one command");
+
+	static constexpr std::array<Entry, 256> make_table() {
+		std::array<Entry, 256> table {};
+		((table[Cmds::OPCODE] = Entry { &Cmds::decode_and_execute,
+				Cmds::PAYLOAD_SIZE }), ...);
+		return table;
+	}
+
+	static constexpr std::array<Entry, 256> TABLE = make_table();
+};
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 
+#include "command_table.hpp"
 #include "constants.hpp"
 
 // Ensure structs are packed to avoid padding
@@ -46,6 +47,15 @@ struct InverseKinematicsCommand {
 	void execute();
 };
 
+// Struct for 'K' command - Same as 'k', in single precision
+struct InverseKinematicsFloatCommand {
+	float x_dot;
+	float y_dot;
+	float theta_dot;
+
+	void execute();
+};
+
 // Struct for 'l' command - Print message to LCD
 struct LcdPrintCommand {
 	uint8_t line;
@@ -54,4 +64,127 @@ struct LcdPrintCommand {
 	void execute();
 };
 
+// Struct for 'w' command - Stream wheel telemetry at the given rate, COBS framing only (see HOST_PROTOCOL_COBS)
+struct SubscribeTelemetryCommand {
+	uint16_t rate_hz;
+
+	void execute();
+};
+
+// Struct for 'q' command - Stop streaming wheel telemetry
+struct UnsubscribeTelemetryCommand {
+	void execute();
+};
+
+// Struct for 'v' command - Read synchronised velocity commit timings
+struct ReadVelocityCommitStatsCommand {
+	void execute();
+};
+
+// Struct for 'e' command - Read how many writes each stepper driver lost
+struct ReadStepperLostWritesCommand {
+	void execute();
+};
+
+// Struct for 'd' command - Read the stepper drivers' cached diagnostics
+struct ReadStepperStatusCommand {
+	void execute();
+};
+
+// Struct for 'r' command - Set the wheel velocity ramp limits, both positive and finite or ignored
+struct SetRampLimitsCommand {
+	float acceleration; // rad/s^2
+	float jerk; // rad/s^3
+
+	void execute();
+};
+
+// Struct for 'm' command - Select how wheel velocities get to the motors, see MotionBackend
+struct SetMotionBackendCommand {
+	uint8_t backend;
+
+	void execute();
+};
+
+// Struct for 'c' command - Read the steps sent to each wheel in STEP/DIR mode
+struct ReadStepCountsCommand {
+	void execute();
+};
+
+// Struct for 'g' command - Set the wheel speed loop gains, a max correction of 0 for open loop. Ignored if any is
+// negative or not finite.
+struct SetSpeedLoopGainsCommand {
+	float kp;
+	float ki; // 1/s
+	float max_correction; // rad/s
+
+	void execute();
+};
+
+// Struct for 'f' command - Sample the wheel encoders at the given rate, 0 to stop
+struct SetEncoderSampleRateCommand {
+	uint16_t rate_hz;
+
+	void execute();
+};
+
+// Struct for 'j' command - Read encoder sampling statistics
+struct ReadEncoderSamplingStatsCommand {
+	void execute();
+};
+
+// Struct for 'n' command - Set the wheel state estimator's noise, and whether it goes by the commanded speeds
+struct SetEstimatorNoiseCommand {
+	float acceleration; // rad^2/s^3
+	float measurement; // rad^2
+	uint8_t use_command;
+
+	void execute();
+};
+
+// Struct for 't' command - Read the wheels' multi-turn encoder counts, and start them over from 0 if reset
+struct LatchWheelTicksCommand {
+	uint8_t reset;
+
+	void execute();
+};
+
+// Struct for 'o' command - Read the odometry pose and twist, and start the pose over from the origin if reset
+struct ReadOdometryCommand {
+	uint8_t reset;
+
+	void execute();
+};
+
+// Struct for 'b' command - Read boot timings
+struct ReadBootStatsCommand {
+	void execute();
+};
+
 #pragma pack(pop)
+
+// Opcode bindings for the host link.
+using HostCommands = CommandTable<
+		Cmd<'s', SetServoCommand>,
+		Cmd<'a', ReadWheelInfoCommand>,
+		Cmd<'u', SetWheelSpeedsCommand>,
+		Cmd<'x', StopSteppersCommand>,
+		Cmd<'p', PongCommand>,
+		Cmd<'k', InverseKinematicsCommand>,
+		Cmd<'K', InverseKinematicsFloatCommand>,
+		Cmd<'l', LcdPrintCommand>,
+		Cmd<'w', SubscribeTelemetryCommand>,
+		Cmd<'q', UnsubscribeTelemetryCommand>,
+		Cmd<'v', ReadVelocityCommitStatsCommand>,
+		Cmd<'e', ReadStepperLostWritesCommand>,
+		Cmd<'d', ReadStepperStatusCommand>,
+		Cmd<'r', SetRampLimitsCommand>,
+		Cmd<'m', SetMotionBackendCommand>,
+		Cmd<'c', ReadStepCountsCommand>,
+		Cmd<'b', ReadBootStatsCommand>,
+		Cmd<'g', SetSpeedLoopGainsCommand>,
+		Cmd<'f', SetEncoderSampleRateCommand>,
+		Cmd<'j', ReadEncoderSamplingStatsCommand>,
+		Cmd<'n', SetEstimatorNoiseCommand>,
+		Cmd<'t', LatchWheelTicksCommand>,
+		Cmd<'o', ReadOdometryCommand>>;
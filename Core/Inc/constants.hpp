@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 constexpr double WHEEL_RADIUS = 65e-3;  // m
 constexpr double WHEEL_BASE = 200e-3; // m
 constexpr double SIN_PI_3 = 0.8660254037844386;
@@ -8,11 +11,78 @@ constexpr double SQRT_3 = 1.7320508075688772;
 constexpr double FSC = 200; // motor fullsteps per rotation
 constexpr double USC = 1; // microsteps
 constexpr double TAU = 6.283185307179586; // 2pi
+constexpr double VACTUAL_STEP_RATE = 0.715; // Hz per VACTUAL unit, based on the TMC2209 internal oscillator
+
+constexpr size_t TMC_BUS_QUEUE_LENGTH = 16; // Datagrams.
+// Writes are checked against the drivers' IFCNT this often at most, one read per driver for all writes since the last
+// check, and lost ones sent again.
+constexpr uint32_t TMC_WRITE_VERIFY_PERIOD_MS = 20;
+// Read the stepper drivers' configuration back at boot, waiting for it. The IFCNT check already catches lost writes
+// once the main loop runs, this also catches a wrong value, but boot then waits for the 33 configuration writes and
+// 9 reads to go through: about 35 ms at 115200 baud.
+constexpr bool TMC_BRINGUP_READBACK = false;
+
+// Wheel velocities are ramped and sent to the drivers at this rate. A burst of three VACTUAL writes takes 2.1 ms at
+// 115200 baud, leave the bus some room for everything else.
+constexpr uint16_t VELOCITY_COMMIT_RATE_HZ = 200;
+// Default wheel velocity ramp limits, 0 for none. Settable at runtime with the 'r' command, which takes positive
+// limits only.
+constexpr double RAMP_MAX_ACCELERATION = 20; // rad/s^2
+constexpr double RAMP_MAX_JERK = 400; // rad/s^3
+
+// Per-wheel speed loop on top of the ramped velocities, fed back from the encoders' speed estimates: feed-forward plus
+// PI, settable at runtime with the 'g' command. A max correction of 0 leaves the wheels open loop.
+constexpr double SPEED_LOOP_KP = 0.3;
+constexpr double SPEED_LOOP_KI = 2; // Per second.
+constexpr double SPEED_LOOP_MAX_CORRECTION = 2; // rad/s
+// Speed estimates older than this aren't fed back: the wheels run open loop until fresh ones come in.
+constexpr uint32_t SPEED_LOOP_STALE_MS = 50;
+// Wheel state estimator defaults, settable at runtime with the 'n' command. The measurement noise covers the
+// encoders' quantisation and the uncertainty on when in the read the angle was latched.
+constexpr double ESTIMATOR_ACCELERATION_NOISE = 10; // rad^2/s^3
+constexpr double ESTIMATOR_MEASUREMENT_NOISE = 2e-6; // rad^2
+constexpr bool ESTIMATOR_USE_COMMAND = true;
+// 1 if the encoders count up when the wheels turn at a positive VACTUAL, -1 if they count down.
+constexpr double WHEEL_ENCODER_SIGN = 1;
 
-constexpr uint8_t STEPPER_CMDS_REPETITION = 1;
+// How the wheel velocities get to the motors at boot, switchable at runtime with the 'm' command: VACTUAL over the
+// TMC2209 UART, or STEP pulses from TIM2 with VACTUAL held at 0.
+enum class MotionBackend : uint8_t {
+	VACTUAL = 0, STEP_DIR = 1,
+};
+constexpr MotionBackend MOTION_BACKEND_DEFAULT = MotionBackend::VACTUAL;
+// Fastest the wheels are ever driven, rad/s: about 2 m/s at the rim. STEP rates are capped at the matching step rate,
+// under 1 kHz at full steps: with two interrupts per step and wheel, that's under 6k TIM2 interrupts per second.
+constexpr double WHEEL_MAX_SPEED = 30;
+constexpr float STEP_MAX_RATE_HZ = static_cast<float>(WHEEL_MAX_SPEED * FSC * USC / TAU);
 
 constexpr int32_t ENCODER_FULL_RANGE = 4096;
+// The wheel encoders are sampled at this rate by TIM3, settable at runtime with the 'f' command. Reading all three
+// takes about 2 ms on the 100 kHz I2C, which the LCD's I/O expander on the same bus can't go any faster than.
+constexpr uint16_t ENCODER_SAMPLE_RATE_HZ = 200;
+constexpr uint16_t ENCODER_SAMPLE_MIN_RATE_HZ = 20; // TIM3 counts at 1 MHz over 16 bits.
+constexpr uint16_t ENCODER_SAMPLE_MAX_RATE_HZ = 400;
+// The I2C's SCL low timeout: a device holding the clock low this long fails the transfer, and the encoders' sample.
+constexpr uint32_t ENCODER_BUS_TIMEOUT_US = 200;
+// Reading the three encoders takes about 2 ms at 100 kHz. One still in flight after this lost an interrupt somewhere,
+// and is given up on by the next one.
+constexpr uint32_t ENCODER_ACQUISITION_TIMEOUT_US = 5000;
+// Samples further apart than this can't tell how many turns a wheel made in between: half a turn in this long is
+// 31 rad/s, above WHEEL_MAX_SPEED. Past it, the filter and the tick counts start over.
+constexpr uint32_t ENCODER_MAX_SAMPLE_GAP_US = 100000;
 
 constexpr uint8_t WHEEL_COUNT = 3;
 
 constexpr uint8_t LCD_WIDTH = 16;
+
+constexpr size_t USB_RX_BUF_SIZE = 256; // Must be a power of two.
+constexpr size_t USB_TX_QUEUE_LENGTH = 8; // Frames.
+
+// Wheel telemetry streaming rates. At 115200 baud the link tops out around 150 samples per second, past that the
+// TX queue drops samples (and counts them).
+constexpr uint16_t TELEMETRY_MIN_RATE_HZ = 10;
+constexpr uint16_t TELEMETRY_MAX_RATE_HZ = 1000;
+
+// Host link protocol: COBS frames with a CRC16 trailer if true, 'M' header + opcode + raw payload otherwise. Replies
+// are raw in the latter, so telemetry streaming needs the former.
+constexpr bool HOST_PROTOCOL_COBS = false;
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "stm32h5xx_hal.h"
+
+// Disables interrupts for the lifetime of the object, restoring the previous PRIMASK state on exit so that it nests.
+class CriticalSection {
+public:
+	CriticalSection() :
+			primask_(__get_PRIMASK()) {
+		__disable_irq();
+	}
+	~CriticalSection() {
+		__set_PRIMASK(primask_);
+	}
+
+	CriticalSection(const CriticalSection&) = delete;
+	CriticalSection& operator=(const CriticalSection&) = delete;
+
+private:
+	uint32_t primask_;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+#include "stm32h5xx_hal.h"
+
+// The DWT cycle counter: runs at the core clock, and wraps every minute or so at 64 MHz, so only differences mean
+// anything.
+inline void cycle_counter_init(void) {
+	DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline uint32_t cycle_counter(void) {
+	return DWT->CYCCNT;
+}
+
+inline uint32_t cycles_to_us(uint32_t cycles) {
+	return cycles / (SystemCoreClock / 1000000);
+}
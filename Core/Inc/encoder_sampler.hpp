@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+#include "stm32h5xx_hal.h"
+#include "constants.hpp"
+#include "peripherals/as5600_bus.hpp"
+#include "wheel_speeds_estimator.hpp"
+
+#pragma pack(push, 1)
+// Reply to the 'j' command. Periods are between timer interrupts, which is when the acquisitions start.
+struct EncoderSamplingStats {
+	uint16_t rate_hz;        // 0 while stopped.
+	uint32_t samples;        // Acquisitions started.
+	uint32_t overruns;       // Ticks skipped: the last acquisition was still going, or the LCD had the bus.
+	uint32_t failed;         // Acquisitions that failed on the bus, timeouts included.
+	uint32_t timeouts;
+	uint32_t min_period_us;
+	uint32_t max_period_us;
+	uint32_t mean_period_us;
+};
+#pragma pack(pop)
+
+// Starts an encoder acquisition on every tick of a timer, so the speed estimator gets evenly spaced samples however
+// busy the main loop is, and keeps track of how evenly spaced they actually are.
+class EncoderSampler {
+public:
+	void init(WheelSpeedsEstimator *estimator, AS5600Bus *bus,
+			TIM_HandleTypeDef *tim);
+
+	// Clamped to ENCODER_SAMPLE_MIN/MAX_RATE_HZ. Starts the statistics over.
+	HAL_StatusTypeDef start(uint16_t rate_hz);
+	HAL_StatusTypeDef stop(void);
+
+	// Called from the timer's interrupt.
+	void on_tick(void);
+
+	EncoderSamplingStats get_stats(void);
+
+private:
+	WheelSpeedsEstimator *estimator_ = nullptr;
+	AS5600Bus *bus_ = nullptr;
+	TIM_HandleTypeDef *tim_ = nullptr;
+
+	uint16_t rate_hz_ = 0;
+	uint32_t samples_ = 0, overruns_ = 0;
+	uint32_t failed_at_start_ = 0, timeouts_at_start_ = 0;
+	uint32_t ticks_ = 0;
+	uint32_t last_tick_at_ = 0; // Cycle counter.
+	uint32_t min_period_us_ = 0, max_period_us_ = 0;
+	uint64_t total_period_us_ = 0;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "constants.hpp"
+
+// Q16.16 fixed point number: 16 integer bits, 16 fractional bits, range about ±32768.
+class Q16_16 {
+public:
+	constexpr Q16_16() = default;
+	// Meant for constants: at runtime this is a soft-float conversion.
+	explicit constexpr Q16_16(double value) :
+			raw_(static_cast<int32_t>(value * ONE + (value < 0 ? -0.5 : 0.5))) {
+	}
+
+	static constexpr Q16_16 from_raw(int32_t raw) {
+		Q16_16 q;
+		q.raw_ = raw;
+		return q;
+	}
+
+	constexpr int32_t raw() const {
+		return raw_;
+	}
+
+	// Truncates toward zero, like converting a float does.
+	explicit constexpr operator int32_t() const {
+		return raw_ / ONE;
+	}
+
+	constexpr Q16_16 operator+(Q16_16 other) const {
+		return from_raw(raw_ + other.raw_);
+	}
+	constexpr Q16_16 operator-(Q16_16 other) const {
+		return from_raw(raw_ - other.raw_);
+	}
+	constexpr Q16_16 operator-() const {
+		return from_raw(-raw_);
+	}
+	constexpr Q16_16 operator*(Q16_16 other) const {
+		return from_raw(
+				static_cast<int32_t>((int64_t(raw_) * other.raw_) >> 16));
+	}
+
+private:
+	static constexpr int32_t ONE = 1 << 16;
+	int32_t raw_ = 0;
+};
+
+// Wheel speeds (rad/s) from the body twist (x_dot and y_dot in m/s, theta_dot in rad/s), for the three wheels at 120°
+// from each other. Row i is wheel i + 1.
+constexpr double IK_MATRIX[WHEEL_COUNT][3] = {
+		{ 1 / WHEEL_RADIUS, 0, -WHEEL_BASE / WHEEL_RADIUS },
+		{ -0.5 / WHEEL_RADIUS, -SIN_PI_3 / WHEEL_RADIUS, -WHEEL_BASE / WHEEL_RADIUS },
+		{ -0.5 / WHEEL_RADIUS, SIN_PI_3 / WHEEL_RADIUS, -WHEEL_BASE / WHEEL_RADIUS } };
+
+// Body twist from the wheel speeds, the inverse of IK_MATRIX. Column i is wheel i + 1.
+constexpr double FK_MATRIX[3][WHEEL_COUNT] = {
+		{ 2 * WHEEL_RADIUS / 3, -WHEEL_RADIUS / 3, -WHEEL_RADIUS / 3 },
+		{ 0, -WHEEL_RADIUS / SQRT_3, WHEEL_RADIUS / SQRT_3 },
+		{ -WHEEL_RADIUS / (3 * WHEEL_BASE), -WHEEL_RADIUS / (3 * WHEEL_BASE),
+				-WHEEL_RADIUS / (3 * WHEEL_BASE) } };
+
+constexpr bool fk_inverts_ik(void) {
+	for (uint8_t i = 0; i < 3; ++i) {
+		for (uint8_t j = 0; j < 3; ++j) {
+			double sum = 0;
+			for (uint8_t k = 0; k < WHEEL_COUNT; ++k) {
+				sum += FK_MATRIX[i][k] * IK_MATRIX[k][j];
+			}
+			const double error = sum - (i == j ? 1 : 0);
+			if (error > 1e-9 || error < -1e-9)
+				return false;
+		}
+	}
+	return true;
+}
+static_assert(fk_inverts_ik(), "FK_MATRIX must be the inverse of IK_MATRIX");
+
+constexpr double RAD_PER_S_TO_VACTUAL = FSC * USC / TAU / VACTUAL_STEP_RATE;
+
+// Kinematics in T, which is float (the M33 FPU is single precision only, double is all soft-float) or Q16_16.
+// The unit conversion to VACTUAL is folded into the matrix at compile time, so the inverse kinematics come down to
+// nine multiply-adds.
+template<typename T>
+class Kinematics {
+public:
+	// VACTUAL register values for each wheel from the body twist.
+	static void inverse(T x_dot, T y_dot, T theta_dot, int32_t *vactual) {
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			vactual[i] = static_cast<int32_t>(
+					MATRIX[i][0] * x_dot + MATRIX[i][1] * y_dot
+							+ MATRIX[i][2] * theta_dot);
+		}
+	}
+
+	static int32_t rad_per_s_to_vactual(T u) {
+		return static_cast<int32_t>(u * VACTUAL_PER_RAD_S);
+	}
+
+private:
+	using Matrix = std::array<std::array<T, 3>, WHEEL_COUNT>;
+
+	static constexpr Matrix make_matrix() {
+		Matrix m {};
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			for (uint8_t j = 0; j < 3; ++j) {
+				m[i][j] = T(IK_MATRIX[i][j] * RAD_PER_S_TO_VACTUAL);
+			}
+		}
+		return m;
+	}
+
+	static constexpr Matrix MATRIX = make_matrix();
+	static constexpr T VACTUAL_PER_RAD_S = T(RAD_PER_S_TO_VACTUAL);
+};
@@ -63,6 +63,22 @@ void Error_Handler(void);
 /* Private defines -----------------------------------------------------------*/
 
 /* USER CODE BEGIN Private defines */
+// STEP outputs on TIM2 channels 1 to 3, and DIR outputs, for the wheel drivers' STEP/DIR interface.
+// STEP2 takes PB3, which is also SWO: TIM2_CH2's other AF1 pin is PA1, already the TMC2209 UART's RX. SWV
+// trace is given up for it, SWD debugging (PA13/PA14) is unaffected. Leave SWV off in the debug configuration, or
+// the debugger takes PB3 back for trace and wheel 2 doesn't step.
+#define STEP1_Pin GPIO_PIN_0
+#define STEP1_GPIO_Port GPIOA
+#define STEP2_Pin GPIO_PIN_3
+#define STEP2_GPIO_Port GPIOB
+#define STEP3_Pin GPIO_PIN_10
+#define STEP3_GPIO_Port GPIOB
+#define DIR1_Pin GPIO_PIN_0
+#define DIR1_GPIO_Port GPIOC
+#define DIR2_Pin GPIO_PIN_1
+#define DIR2_GPIO_Port GPIOC
+#define DIR3_Pin GPIO_PIN_2
+#define DIR3_GPIO_Port GPIOC
 
 /* USER CODE END Private defines */
 
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#include "constants.hpp"
+
+#pragma pack(push, 1)
+// Reply to the 'o' command.
+struct OdometryState {
+	float x, y, psi; // m and rad, in the frame the robot started or was last reset in.
+	float x_dot, y_dot, psi_dot; // Body twist, m/s and rad/s in the robot's own frame.
+	uint32_t timestamp_us; // When the wheel speeds the pose is integrated up to were measured, see timebase.hpp.
+};
+#pragma pack(pop)
+
+// Dead reckoning from the wheel speed estimates: the body twist from the forward kinematics, integrated into the pose
+// on every encoder sample. Second order: the twist averaged over the interval, and turned by the heading halfway
+// through it.
+class Odometry {
+public:
+	// Wheel speeds in rad/s, the way the inverse kinematics count them, at `time_us`.
+	void update(const float *wheel_speeds, uint32_t time_us);
+	// The pose starts over from the origin, the twist carries on.
+	void reset(void);
+
+	OdometryState get_state(void) const {
+		return state_;
+	}
+
+private:
+	OdometryState state_ { };
+	bool started_ = false;
+};
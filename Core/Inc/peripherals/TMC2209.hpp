@@ -8,9 +8,12 @@
 #ifndef TMC2209_H
 #define TMC2209_H
 
+#include <array>
 #include <cstdint>
 #include <cstddef>
 #include "stm32h5xx_hal.h"
+#include "peripherals/tmc2209_bus.hpp"
+#include "peripherals/tmc2209_registers.hpp"
 
 class TMC2209
 {
@@ -24,17 +27,75 @@ public:
     SERIAL_ADDRESS_2=2,
     SERIAL_ADDRESS_3=3,
   };
-  // Identify which microcontroller serial port is connected to the TMC2209 e.g.
-  // Serial1, Serial2, etc. Optionally identify which serial address is assigned
-  // to the TMC2209 if not the default of SERIAL_ADDRESS_0.
+  // Identify which bus the TMC2209 is connected to, several drivers may share
+  // one. Optionally identify which serial address is assigned to the TMC2209
+  // if not the default of SERIAL_ADDRESS_0.
   void setup(
-    UART_HandleTypeDef *huart,
+    TMC2209Bus *bus,
     long serial_baud_rate=115200,
     SerialAddress serial_address=SERIAL_ADDRESS_0);
   // Alternate rx and tx pins may be specified for certain microcontrollers e.g.
   // ESP32 and RP2040
 
+  // Declarative alternative to setup() and the setters below, for bringing
+  // several drivers up at once: registerImage() resolves a Config at compile
+  // time to the one value each register gets, in the order they are to be
+  // written, and writeRegisterImage() sends each register to all the drivers
+  // in a single burst.
+  enum StandstillMode
+  {
+    NORMAL=0,
+    FREEWHEELING=1,
+    STRONG_BRAKING=2,
+    BRAKING=3,
+  };
+  struct Config
+  {
+    uint8_t run_current_percent = 100;
+    uint8_t hold_current_percent = 0;
+    uint8_t hold_delay_percent = 7; // IHOLDDELAY 1
+    uint16_t microsteps_per_step = 256;
+    bool inverse_motor_direction = false;
+    bool stealth_chop = true;
+    bool automatic_current_scaling = false;
+    bool automatic_gradient_adaptation = false;
+    StandstillMode standstill_mode = NORMAL;
+    uint8_t power_down_delay = 20;
+    uint32_t stealth_chop_duration_threshold = 0;
+    uint32_t cool_step_duration_threshold = 0;
+    uint8_t stall_guard_threshold = 0;
+    bool enabled = true;
+  };
+  struct RegisterWrite
+  {
+    uint8_t address;
+    uint32_t value;
+  };
+  const static uint8_t REGISTER_IMAGE_SIZE = 11;
+  typedef std::array<RegisterWrite, REGISTER_IMAGE_SIZE> RegisterImage;
+  static constexpr RegisterImage registerImage(const Config & config);
+
+  // Queue the image for all the drivers, which take it as their register
+  // state. `on_sent` is called from the bus interrupt as each register's burst
+  // completes, REGISTER_IMAGE_SIZE times in all unless queueing failed, which
+  // returns false. count is at most TMC2209Bus::MAX_BURST.
+  static bool writeRegisterImage(TMC2209 * const * drivers,
+    uint8_t count,
+    const RegisterImage & image,
+    TMC2209Bus::Callback on_sent,
+    void * context);
+  // Read the registers that can be back and compare them with the image,
+  // all the reads queued at once. Blocking.
+  bool verifyRegisterImage(const RegisterImage & image);
+  // For bring-up with writeRegisterImage(): like setup(), without writing.
+  void attach(TMC2209Bus *bus,
+    long serial_baud_rate=115200,
+    SerialAddress serial_address=SERIAL_ADDRESS_0);
+
   // unidirectional methods
+  // These only update the driver's shadow registers: flush() then sends the
+  // registers that changed since the last flush, back to back, so setting a
+  // register to the value it already has costs nothing on the bus.
 
   // driver must be enabled before use it is disabled by default
   void setHardwareEnablePin(GPIO_TypeDef* port, uint16_t pin);
@@ -65,13 +126,6 @@ public:
   void enableInverseMotorDirection();
   void disableInverseMotorDirection();
 
-  enum StandstillMode
-  {
-    NORMAL=0,
-    FREEWHEELING=1,
-    STRONG_BRAKING=2,
-    BRAKING=3,
-  };
   void setStandstillMode(StandstillMode mode);
 
   void enableAutomaticCurrentScaling();
@@ -95,6 +149,30 @@ public:
   void moveAtVelocity(int32_t microsteps_per_period);
   void moveUsingStepDirInterface();
 
+  // Each datagram may be sent several times in a row, for noisy buses.
+  void flush(uint8_t repetitions=1);
+  // Hand VACTUAL over to a caller that writes it to the bus itself, e.g.
+  // from a timer interrupt. flush() leaves it alone from then on, and when
+  // write verification finds writes lost, on_lost_write is called for the
+  // caller to send VACTUAL again.
+  typedef void (*LostWriteCallback)(void * context, uint8_t serial_address);
+  void delegateVelocity(LostWriteCallback on_lost_write, void * context);
+  uint8_t getSerialAddress();
+  const static uint8_t ADDRESS_VACTUAL = tmc2209_reg::VACTUAL::ADDRESS;
+  // Mark every register as changed, e.g. after the driver lost power, so that
+  // the next flush rewrites the whole configuration.
+  void invalidateShadowRegisters();
+
+  // Write delivery check, to be called regularly from thread mode. IFCNT
+  // counts the writes the driver accepted: once writes went out since the
+  // last check, it is read in the background, and if it fell short of what
+  // was sent, the registers written since the last check are sent again.
+  // IFCNT only tells how many writes were lost, not which, but register
+  // writes can be repeated safely.
+  void verifyWrites();
+  // Writes the driver never acknowledged, since reset.
+  uint32_t getLostWriteCount();
+
   void enableStealthChop();
   void disableStealthChop();
 
@@ -222,156 +300,54 @@ public:
 
   uint16_t getMicrostepCounter();
 
+  // The methods above wait for the bus to complete the read. This one queues
+  // it and returns, the callback gets the register value from the UART
+  // interrupt once the reply is in.
+  bool readAsync(uint8_t register_address,
+    TMC2209Bus::Callback callback,
+    void *context);
+  // Status registers, for reading them asynchronously.
+  const static uint8_t ADDRESS_TSTEP = tmc2209_reg::TSTEP::ADDRESS;
+  const static uint8_t ADDRESS_SG_RESULT = tmc2209_reg::SG_RESULT::ADDRESS;
+  const static uint8_t ADDRESS_DRV_STATUS = tmc2209_reg::DRV_STATUS::ADDRESS;
+  const static uint8_t ADDRESS_PWM_SCALE = tmc2209_reg::PWM_SCALE::ADDRESS;
+
 private:
-  UART_HandleTypeDef *huart_;
+  TMC2209Bus *bus_;
   uint32_t serial_baud_rate_;
   uint8_t serial_address_;
   GPIO_TypeDef *hardware_enable_port_;
   uint16_t hardware_enable_pin_;
 
-  void initialize(UART_HandleTypeDef *huart, long serial_baud_rate=115200,
+  void initialize(TMC2209Bus *bus, long serial_baud_rate=115200,
     SerialAddress serial_address=SERIAL_ADDRESS_0);
 //  int serialAvailable();
 //  size_t serialWrite(uint8_t c);
 //  int serialRead();
 //  void serialFlush();
 
-  // Serial Settings
-  const static uint8_t BYTE_MAX_VALUE = 0xFF;
-  const static uint8_t BITS_PER_BYTE = 8;
-
-  const static uint32_t ECHO_DELAY_INC_MICROSECONDS = 1;
-  const static uint32_t ECHO_DELAY_MAX_MICROSECONDS = 40000;
-
-  const static uint32_t REPLY_DELAY_INC_MICROSECONDS = 1;
-  const static uint32_t REPLY_DELAY_MAX_MICROSECONDS = 10000;
-
   const static uint8_t STEPPER_DRIVER_FEATURE_OFF = 0;
   const static uint8_t STEPPER_DRIVER_FEATURE_ON = 1;
 
-  // Datagrams
-  const static uint8_t WRITE_READ_REPLY_DATAGRAM_SIZE = 8;
-  const static uint8_t DATA_SIZE = 4;
-  union WriteReadReplyDatagram
-  {
-    struct
-    {
-      uint64_t sync : 4;
-      uint64_t reserved : 4;
-      uint64_t serial_address : 8;
-      uint64_t register_address : 7;
-      uint64_t rw : 1;
-      uint64_t data : 32;
-      uint64_t crc : 8;
-    };
-    uint64_t bytes;
-  };
-
-  const static uint8_t SYNC = 0b101;
-  const static uint8_t RW_READ = 0;
-  const static uint8_t RW_WRITE = 1;
-  const static uint8_t READ_REPLY_SERIAL_ADDRESS = 0b11111111;
-
-  const static uint8_t READ_REQUEST_DATAGRAM_SIZE = 4;
-  union ReadRequestDatagram
-  {
-    struct
-    {
-      uint32_t sync : 4;
-      uint32_t reserved : 4;
-      uint32_t serial_address : 8;
-      uint32_t register_address : 7;
-      uint32_t rw : 1;
-      uint32_t crc : 8;
-    };
-    uint32_t bytes;
-  };
-
   // General Configuration Registers
-  const static uint8_t ADDRESS_GCONF = 0x00;
-  union GlobalConfig
-  {
-    struct
-    {
-      uint32_t i_scale_analog : 1;
-      uint32_t internal_rsense : 1;
-      uint32_t enable_spread_cycle : 1;
-      uint32_t shaft : 1;
-      uint32_t index_otpw : 1;
-      uint32_t index_step : 1;
-      uint32_t pdn_disable : 1;
-      uint32_t mstep_reg_select : 1;
-      uint32_t multistep_filt : 1;
-      uint32_t test_mode : 1;
-      uint32_t reserved : 22;
-    };
-    uint32_t bytes;
-  };
-  GlobalConfig global_config_;
+  // Register values are kept as plain words, fields are read and updated
+  // through the register map.
+  const static uint8_t ADDRESS_GCONF = tmc2209_reg::GCONF::ADDRESS;
+  uint32_t global_config_;
 
-  const static uint8_t ADDRESS_GSTAT = 0x01;
-  union GlobalStatusUnion
-  {
-    struct
-    {
-      GlobalStatus global_status;
-    };
-    uint32_t bytes;
-  };
+  const static uint8_t ADDRESS_GSTAT = tmc2209_reg::GSTAT::ADDRESS;
 
-  const static uint8_t ADDRESS_IFCNT = 0x02;
+  const static uint8_t ADDRESS_IFCNT = tmc2209_reg::IFCNT::ADDRESS;
 
-  const static uint8_t ADDRESS_REPLYDELAY = 0x03;
-  union ReplyDelay
-  {
-    struct
-    {
-      uint32_t reserved_0 : 8;
-      uint32_t replydelay : 4;
-      uint32_t reserved_1 : 20;
-    };
-    uint32_t bytes;
-  };
+  const static uint8_t ADDRESS_REPLYDELAY = tmc2209_reg::NODECONF::ADDRESS;
 
-  const static uint8_t ADDRESS_IOIN = 0x06;
-  union Input
-  {
-    struct
-    {
-      uint32_t enn : 1;
-      uint32_t reserved_0 : 1;
-      uint32_t ms1 : 1;
-      uint32_t ms2 : 1;
-      uint32_t diag : 1;
-      uint32_t reserved_1 : 1;
-      uint32_t pdn_serial : 1;
-      uint32_t step : 1;
-      uint32_t spread_en : 1;
-      uint32_t dir : 1;
-      uint32_t reserved_2 : 14;
-      uint32_t version : 8;
-    };
-    uint32_t bytes;
-  };
+  const static uint8_t ADDRESS_IOIN = tmc2209_reg::IOIN::ADDRESS;
   const static uint8_t VERSION = 0x21;
 
 
   // Velocity Dependent Driver Feature Control Register Set
-  const static uint8_t ADDRESS_IHOLD_IRUN = 0x10;
-  union DriverCurrent
-  {
-    struct
-    {
-      uint32_t ihold : 5;
-      uint32_t reserved_0 : 3;
-      uint32_t irun : 5;
-      uint32_t reserved_1 : 3;
-      uint32_t iholddelay : 4;
-      uint32_t reserved_2 : 12;
-    };
-    uint32_t bytes;
-  };
-  DriverCurrent driver_current_;
+  const static uint8_t ADDRESS_IHOLD_IRUN = tmc2209_reg::IHOLD_IRUN::ADDRESS;
+  uint32_t driver_current_;
   const static uint8_t PERCENT_MIN = 0;
   const static uint8_t PERCENT_MAX = 100;
   const static uint8_t CURRENT_SETTING_MIN = 0;
@@ -382,44 +358,25 @@ private:
   const static uint8_t IRUN_DEFAULT = 31;
   const static uint8_t IHOLDDELAY_DEFAULT = 1;
 
-  const static uint8_t ADDRESS_TPOWERDOWN = 0x11;
+  const static uint8_t ADDRESS_TPOWERDOWN = tmc2209_reg::TPOWERDOWN::ADDRESS;
   const static uint8_t TPOWERDOWN_DEFAULT = 20;
 
-  const static uint8_t ADDRESS_TSTEP = 0x12;
 
-  const static uint8_t ADDRESS_TPWMTHRS = 0x13;
+  const static uint8_t ADDRESS_TPWMTHRS = tmc2209_reg::TPWMTHRS::ADDRESS;
   const static uint32_t TPWMTHRS_DEFAULT = 0;
 
-  const static uint8_t ADDRESS_VACTUAL = 0x22;
   const static int32_t VACTUAL_DEFAULT = 0;
   const static int32_t VACTUAL_STEP_DIR_INTERFACE = 0;
 
   // CoolStep and StallGuard Control Register Set
-  const static uint8_t ADDRESS_TCOOLTHRS = 0x14;
+  const static uint8_t ADDRESS_TCOOLTHRS = tmc2209_reg::TCOOLTHRS::ADDRESS;
   const static uint8_t TCOOLTHRS_DEFAULT = 0;
-  const static uint8_t ADDRESS_SGTHRS = 0x40;
+  const static uint8_t ADDRESS_SGTHRS = tmc2209_reg::SGTHRS::ADDRESS;
   const static uint8_t SGTHRS_DEFAULT = 0;
-  const static uint8_t ADDRESS_SG_RESULT = 0x41;
 
-  const static uint8_t ADDRESS_COOLCONF = 0x42;
+  const static uint8_t ADDRESS_COOLCONF = tmc2209_reg::COOLCONF::ADDRESS;
   const static uint8_t COOLCONF_DEFAULT = 0;
-  union CoolConfig
-  {
-    struct
-    {
-      uint32_t semin : 4;
-      uint32_t reserved_0 : 1;
-      uint32_t seup : 2;
-      uint32_t reserved_1 : 1;
-      uint32_t semax : 4;
-      uint32_t reserved_2 : 1;
-      uint32_t sedn : 2;
-      uint32_t seimin : 1;
-      uint32_t reserved_3 : 16;
-    };
-    uint32_t bytes;
-  };
-  CoolConfig cool_config_;
+  uint32_t cool_config_;
   bool cool_step_enabled_;
   const static uint8_t SEIMIN_UPPER_CURRENT_LIMIT = 20;
   const static uint8_t SEIMIN_LOWER_SETTING = 0;
@@ -431,31 +388,12 @@ private:
   const static uint8_t SEMAX_MAX = 15;
 
   // Microstepping Control Register Set
-  const static uint8_t ADDRESS_MSCNT = 0x6A;
-  const static uint8_t ADDRESS_MSCURACT = 0x6B;
+  const static uint8_t ADDRESS_MSCNT = tmc2209_reg::MSCNT::ADDRESS;
+  const static uint8_t ADDRESS_MSCURACT = tmc2209_reg::MSCURACT::ADDRESS;
 
   // Driver Register Set
-  const static uint8_t ADDRESS_CHOPCONF = 0x6C;
-  union ChopperConfig
-  {
-    struct
-    {
-      uint32_t toff : 4;
-      uint32_t hstart : 3;
-      uint32_t hend : 4;
-      uint32_t reserved_0 : 4;
-      uint32_t tbl : 2;
-      uint32_t vsense : 1;
-      uint32_t reserved_1 : 6;
-      uint32_t mres : 4;
-      uint32_t interpolation : 1;
-      uint32_t double_edge : 1;
-      uint32_t diss2g : 1;
-      uint32_t diss2vs : 1;
-    };
-    uint32_t bytes;
-  };
-  ChopperConfig chopper_config_;
+  const static uint8_t ADDRESS_CHOPCONF = tmc2209_reg::CHOPCONF::ADDRESS;
+  uint32_t chopper_config_;
   const static uint32_t CHOPPER_CONFIG_DEFAULT = 0x10000053;
   const static uint8_t TBL_DEFAULT = 0b10;
   const static uint8_t HEND_DEFAULT = 0;
@@ -478,34 +416,8 @@ private:
   const static size_t MICROSTEPS_PER_STEP_MIN = 1;
   const static size_t MICROSTEPS_PER_STEP_MAX = 256;
 
-  const static uint8_t ADDRESS_DRV_STATUS = 0x6F;
-  union DriveStatus
-  {
-    struct
-    {
-      Status status;
-    };
-    uint32_t bytes;
-  };
-
-  const static uint8_t ADDRESS_PWMCONF = 0x70;
-  union PwmConfig
-  {
-    struct
-    {
-      uint32_t pwm_offset : 8;
-      uint32_t pwm_grad : 8;
-      uint32_t pwm_freq : 2;
-      uint32_t pwm_autoscale : 1;
-      uint32_t pwm_autograd : 1;
-      uint32_t freewheel : 2;
-      uint32_t reserved : 2;
-      uint32_t pwm_reg : 4;
-      uint32_t pwm_lim : 4;
-    };
-    uint32_t bytes;
-  };
-  PwmConfig pwm_config_;
+  const static uint8_t ADDRESS_PWMCONF = tmc2209_reg::PWMCONF::ADDRESS;
+  uint32_t pwm_config_;
   const static uint32_t PWM_CONFIG_DEFAULT = 0xC10D0024;
   const static uint8_t PWM_OFFSET_MIN = 0;
   const static uint8_t PWM_OFFSET_MAX = 255;
@@ -514,31 +426,7 @@ private:
   const static uint8_t PWM_GRAD_MAX = 255;
   const static uint8_t PWM_GRAD_DEFAULT = 0x14;
 
-  union PwmScale
-  {
-    struct
-    {
-      uint32_t pwm_scale_sum : 8;
-      uint32_t reserved_0 : 8;
-      uint32_t pwm_scale_auto : 9;
-      uint32_t reserved_1 : 7;
-    };
-    uint32_t bytes;
-  };
-  const static uint8_t ADDRESS_PWM_SCALE = 0x71;
-
-  union PwmAuto
-  {
-    struct
-    {
-      uint32_t pwm_offset_auto : 8;
-      uint32_t reserved_0 : 8;
-      uint32_t pwm_gradient_auto : 8;
-      uint32_t reserved_1 : 8;
-    };
-    uint32_t bytes;
-  };
-  const static uint8_t ADDRESS_PWM_AUTO = 0x72;
+  const static uint8_t ADDRESS_PWM_AUTO = tmc2209_reg::PWM_AUTO::ADDRESS;
 
   void setOperationModeToSerial(SerialAddress serial_address);
 
@@ -549,19 +437,47 @@ private:
 
   void minimizeMotorCurrent();
 
-  uint32_t reverseData(uint32_t data);
-  template<typename Datagram>
-  uint8_t calculateCrc(Datagram & datagram,
-    uint8_t datagram_size);
-  template<typename Datagram>
-  void sendDatagramUnidirectional(Datagram & datagram,
-    uint8_t datagram_size);
-  template<typename Datagram>
-  void sendDatagramBidirectional(Datagram & datagram,
-    uint8_t datagram_size);
+  // Shadow registers, for the registers that keep what is written to them.
+  // Sent in this order on flush, so that the driver is configured before the
+  // chopper gets enabled and the motor moves.
+  struct ShadowRegister
+  {
+    uint8_t address;
+    bool valid;
+    bool dirty;
+    uint32_t value;
+  };
+  const static uint8_t SHADOW_REGISTER_COUNT = 11;
+  ShadowRegister shadow_registers_[SHADOW_REGISTER_COUNT];
+  ShadowRegister * findShadowRegister(uint8_t register_address);
+  uint16_t shadowRegisterBit(const ShadowRegister * shadow);
+
+  // Write verification. Registers are tracked as a bit mask of shadow
+  // registers, those written since the IFCNT read in flight was queued are
+  // checked by the next one.
+  uint16_t unverified_registers_;
+  uint16_t verifying_registers_;
+  bool interface_counter_valid_;
+  uint8_t interface_counter_;
+  uint32_t writes_at_interface_counter_;
+  uint32_t lost_writes_;
+  LostWriteCallback velocity_lost_write_callback_;
+  void * velocity_lost_write_context_;
+  volatile bool verify_pending_;
+  volatile bool verify_done_;
+  volatile bool verify_ok_;
+  volatile uint8_t verify_interface_counter_;
+  volatile uint32_t verify_writes_;
+  void startWriteVerification();
+  void checkWriteVerification();
+  static void onInterfaceCounter(void * context,
+    bool ok,
+    uint32_t data);
 
   void write(uint8_t register_address,
     uint32_t data);
+  void writeDatagram(uint8_t register_address,
+    uint32_t data);
   uint32_t read(uint8_t register_address);
 
   uint8_t percentToCurrentSetting(uint8_t percent);
@@ -581,6 +497,71 @@ private:
   uint32_t readPwmConfigBytes();
 
   uint32_t constrain_(uint32_t value, uint32_t low, uint32_t high);
+
+  void adoptRegisterImage(const RegisterImage & image);
+  static constexpr bool isReadable(uint8_t register_address);
 };
 
+constexpr TMC2209::RegisterImage TMC2209::registerImage(const Config & config)
+{
+  // Same conversions as the setters.
+  using namespace tmc2209_reg;
+  auto percent_to = [](uint8_t percent, uint8_t max)
+  {
+    return static_cast<uint32_t>(
+      (percent > PERCENT_MAX ? PERCENT_MAX : percent) * max / PERCENT_MAX);
+  };
+  uint8_t exponent = 0;
+  while (exponent < 8 && (2u << exponent) <= config.microsteps_per_step)
+  {
+    ++exponent;
+  }
+
+  const uint32_t global_config = compose(
+    GCONF::en_spreadcycle::of(!config.stealth_chop),
+    GCONF::shaft::of(config.inverse_motor_direction),
+    GCONF::pdn_disable::of(1),
+    GCONF::mstep_reg_select::of(1),
+    GCONF::multistep_filt::of(1));
+  const uint32_t driver_current = compose(
+    IHOLD_IRUN::ihold::of(
+      percent_to(config.hold_current_percent, CURRENT_SETTING_MAX)),
+    IHOLD_IRUN::irun::of(
+      percent_to(config.run_current_percent, CURRENT_SETTING_MAX)),
+    IHOLD_IRUN::iholddelay::of(
+      percent_to(config.hold_delay_percent, HOLD_DELAY_MAX)));
+  const uint32_t chopper_config = update(CHOPPER_CONFIG_DEFAULT,
+    CHOPCONF::toff::of(config.enabled ? TOFF_DEFAULT : TOFF_DISABLE),
+    CHOPCONF::hstrt::of(HSTART_DEFAULT),
+    CHOPCONF::hend::of(HEND_DEFAULT),
+    CHOPCONF::tbl::of(TBL_DEFAULT),
+    CHOPCONF::mres::of(MRES_001 - exponent));
+  const uint32_t pwm_config = update(PWM_CONFIG_DEFAULT,
+    PWMCONF::pwm_autoscale::of(config.automatic_current_scaling),
+    PWMCONF::pwm_autograd::of(config.automatic_gradient_adaptation),
+    PWMCONF::freewheel::of(config.standstill_mode));
+
+  // Configured before the chopper is enabled and the motor gets to move.
+  return {{
+    {ADDRESS_GCONF, global_config},
+    {ADDRESS_GSTAT, compose(GSTAT::drv_err::of(1))}, // Write 1 to clear
+    {ADDRESS_IHOLD_IRUN, driver_current},
+    {ADDRESS_TPOWERDOWN, config.power_down_delay},
+    {ADDRESS_TPWMTHRS, config.stealth_chop_duration_threshold},
+    {ADDRESS_TCOOLTHRS, config.cool_step_duration_threshold},
+    {ADDRESS_SGTHRS, config.stall_guard_threshold},
+    {ADDRESS_COOLCONF, COOLCONF_DEFAULT},
+    {ADDRESS_PWMCONF, pwm_config},
+    {ADDRESS_VACTUAL, static_cast<uint32_t>(VACTUAL_DEFAULT)},
+    {ADDRESS_CHOPCONF, chopper_config},
+  }};
+}
+
+constexpr bool TMC2209::isReadable(uint8_t register_address)
+{
+  return register_address == ADDRESS_GCONF
+    || register_address == ADDRESS_CHOPCONF
+    || register_address == ADDRESS_PWMCONF;
+}
+
 #endif
@@ -11,8 +11,10 @@ DESCRIPTION:
 
 
 USAGE:
-        // Instantiate an AS5600 structure
-        AS5600_TypeDef *a = AS5600_New();
+        // Set up an AS5600 structure, allocated by the caller
+        static AS5600_TypeDef as5600;
+        AS5600_TypeDef *a = &as5600;
+        AS5600_Construct(a, &hi2c1, AS5600_SLAVE_ADDRESS << 1);
 
     // Configure non-default options, if required.
     a->PositiveRotationDirection = AS5600_DIR_CCW;
@@ -75,7 +77,6 @@ extern "C" {
 
 /**********************    INCLUDE DIRECTIVES    ***********************/
 #include <stdint.h>
-#include <stdlib.h>
 #include "stm32h5xx_hal.h"
 #include "stm32h503xx.h"
 
@@ -173,7 +174,8 @@ typedef struct {
 } AS5600_TypeDef;
 /***********************    FUNCTION PROTOTYPES    ***********************/
 
-AS5600_TypeDef *AS5600_New(void);
+void AS5600_Construct(AS5600_TypeDef *a, I2C_HandleTypeDef *i2cHandle,
+                      uint8_t i2cAddr);
 HAL_StatusTypeDef AS5600_Init(AS5600_TypeDef *a);
 
 HAL_StatusTypeDef AS5600_SetStartPosition(AS5600_TypeDef *const a,
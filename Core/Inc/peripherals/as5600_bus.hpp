@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+#include "stm32h5xx_hal.h"
+#include "constants.hpp"
+#include "peripherals/as5600.h"
+
+constexpr uint8_t TCA9548A_ADDR = (0x71 << 1);  // Shifted left for HAL (7-bit address)
+constexpr uint8_t AS5600_ADDR = (AS5600_SLAVE_ADDRESS << 1);
+
+// Mux channel each wheel's encoder sits behind.
+constexpr uint8_t encoder_mux_channel(uint8_t wheel) {
+	return 2 + wheel;
+}
+
+// TCA9548A control byte selecting `channel`. Channels 5 and 6 are always left on.
+constexpr uint8_t tca9548a_select(uint8_t channel) {
+	return (1 << channel) | 0b01100000;
+}
+
+// One angle reading per wheel, all from the same acquisition.
+struct EncoderSample {
+	uint16_t counts[WHEEL_COUNT];
+	uint32_t timestamps_us[WHEEL_COUNT]; // Halfway through each wheel's read, see timebase.hpp.
+};
+
+// Reads the wheel encoders in the background: for each wheel, a mux select then an ANGLE register read, each transfer
+// started from the previous one's completion interrupt, and the whole sample handed to a callback at the end.
+// A transfer that never completes is caught by the I2C's SCL low timeout in ENCODER_BUS_TIMEOUT_US, and anything else
+// that gets stuck by the next start() after ENCODER_ACQUISITION_TIMEOUT_US: either way the peripheral is reset and the
+// sample failed, rather than waited for.
+class AS5600Bus {
+public:
+	// Called from the I2C interrupt once an acquisition completes. `sample` is only valid if `ok`.
+	using Callback = void (*)(void *context, bool ok, const EncoderSample &sample);
+
+	void init(I2C_HandleTypeDef *hi2c, Callback callback, void *context);
+
+	// Start reading all the wheels. False if the bus is taken, by the last acquisition or by lock().
+	bool start(void);
+
+	// For blocking users of the same I2C, like the LCD: waits for the acquisition in flight and holds off new ones
+	// until unlock(). Thread mode only.
+	void lock(void);
+	void unlock(void);
+
+	// To be called from the HAL I2C callbacks.
+	void on_tx_complete(void);
+	void on_rx_complete(void);
+	void on_error(void);
+
+	uint32_t failed(void) const {
+		return failed_;
+	}
+	uint32_t timeouts(void) const {
+		return timeouts_;
+	}
+
+private:
+	I2C_HandleTypeDef *hi2c_ = nullptr;
+	Callback callback_ = nullptr;
+	void *context_ = nullptr;
+
+	volatile bool busy_ = false, locked_ = false;
+	uint8_t wheel_ = 0;
+	uint8_t select_ = 0; // Sent from here, the HAL only keeps a pointer to it.
+	uint8_t angle_[2] { };
+	uint32_t started_at_ = 0; // Cycle counter.
+	uint32_t read_started_at_ = 0; // µs.
+	EncoderSample sample_ { };
+	volatile uint32_t failed_ = 0, timeouts_ = 0;
+
+	bool select_wheel(void);
+	// True while an acquisition is in flight, short of ENCODER_ACQUISITION_TIMEOUT_US: past that it is given up on.
+	// With interrupts off.
+	bool in_flight(void);
+	void finish(bool ok);
+	void recover(void);
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "stm32h5xx_hal.h"
+#include "constants.hpp"
+#include "peripherals/tmc2209_datagram.hpp"
+#include "cycle_counter.hpp"
+
+// Transaction queue for the single-wire UART shared by the TMC2209 drivers, shifted out by DMA in the background.
+// TX and RX are tied together on the drivers' PDN_UART pin, so every byte sent comes straight back: each transaction
+// receives its own echo followed by the reply, if any, in a single DMA transfer, and the echo is skipped on
+// completion. A reply that never comes is caught by the UART's receiver timeout. Writes have their echo received one
+// datagram at a time, so that each datagram's last byte back off the wire, which is when its driver has it, is timed.
+class TMC2209Bus {
+public:
+	// Writes to this many drivers can go out back to back in a single transfer.
+	static constexpr size_t MAX_BURST = WHEEL_COUNT;
+	static constexpr size_t SERIAL_ADDRESS_COUNT = 4;
+
+	// Called from the UART interrupt once a transaction completes. For reads, `data` is the register value, and `ok`
+	// is false if the reply timed out or was corrupted.
+	using Callback = void (*)(void *context, bool ok, uint32_t data);
+
+	void init(UART_HandleTypeDef *huart);
+
+	// Queue a datagram, built straight into the queue slot DMA sends it from. If the queue is full, waits for room in
+	// thread mode and fails in interrupts.
+	bool write(uint8_t serial_address, uint8_t register_address,
+			uint32_t data);
+	bool read(uint8_t serial_address, uint8_t register_address,
+			Callback callback, void *context);
+	// Write the same register on several drivers in one DMA transfer, with no gap between datagrams.
+	bool write_burst(const uint8_t *serial_addresses, uint8_t register_address,
+			const uint32_t *data, size_t count, Callback callback,
+			void *context);
+
+	// Time a read takes on the wire: request, echo and reply, with the drivers' default reply delay of 8 bit times.
+	uint32_t read_time_us(void) const {
+		constexpr uint32_t bits = (TMC_READ_REQUEST_SIZE + TMC_REPLY_SIZE) * 10
+				+ 8;
+		return (bits * 1000000 + huart_->Init.BaudRate - 1)
+				/ huart_->Init.BaudRate;
+	}
+
+	// True once everything queued has gone out.
+	bool idle(void) const {
+		return head_ == tail_;
+	}
+
+	// To be called from the HAL UART callbacks.
+	void on_tx_complete(void);
+	void on_rx_complete(void);
+	void on_error(void);
+
+	uint32_t failed_reads(void) const {
+		return failed_reads_;
+	}
+
+	// Write datagrams sent to a driver so far, for checking against its IFCNT. Counted as each transaction finishes,
+	// so from a read's callback this is exactly the writes that went out before the read.
+	uint32_t writes_sent(uint8_t serial_address) const {
+		return writes_sent_[serial_address % SERIAL_ADDRESS_COUNT];
+	}
+
+	// Cycle counter value when the transaction being completed went on the wire, for callbacks to time it.
+	uint32_t transfer_started_at(void) const {
+		return transfer_started_at_;
+	}
+	// Cycle counter value when the echo of the write being completed's `index`th datagram was all back, for burst
+	// callbacks to time each driver's write.
+	uint32_t datagram_done_at(size_t index) const {
+		return datagram_done_at_[index];
+	}
+
+private:
+	struct Transaction {
+		uint8_t request[TMC_WRITE_DATAGRAM_SIZE * MAX_BURST];
+		uint8_t request_len;
+		uint8_t reply_len;  // 0 for writes.
+		Callback callback;  // Optional for writes.
+		void *context;
+	};
+
+	UART_HandleTypeDef *huart_ = nullptr;
+	Transaction queue_[TMC_BUS_QUEUE_LENGTH] { };
+	volatile uint32_t head_ = 0, tail_ = 0;  // Free running, the front transaction is the one on the wire.
+	volatile bool busy_ = false, tx_done_ = false, rx_done_ = false,
+			rx_ok_ = false;
+	uint8_t rx_buf_[TMC_WRITE_DATAGRAM_SIZE * MAX_BURST];
+	static_assert(sizeof(rx_buf_) >= TMC_READ_REQUEST_SIZE + TMC_REPLY_SIZE,
+			"The receive buffer takes a read request's echo and its reply");
+	volatile uint32_t failed_reads_ = 0;
+	volatile uint32_t writes_sent_[SERIAL_ADDRESS_COUNT] { };
+	volatile uint32_t transfer_started_at_ = 0;
+	uint32_t datagram_done_at_[MAX_BURST] { };
+	uint8_t rx_received_ = 0; // Echo bytes in so far, for writes.
+
+	// Claims a queue slot and has `fill` build the transaction in it.
+	template<typename Fill>
+	bool submit(Fill fill);
+	void start_next(void);
+	// The part of a transaction's echo and reply to receive next, starting `rx_received_` bytes in.
+	size_t rx_chunk(const Transaction &t) const;
+	void try_complete(void);
+	void count_writes(const Transaction &t);
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// TMC2209 UART datagrams, built byte by byte straight into the buffer they're sent from.
+// Write: sync | serial address | register | 0x80 | data, MSB first | CRC.
+// Read request: sync | serial address | register | CRC, answered by a write datagram addressed to 0xFF.
+constexpr uint8_t TMC_SYNC = 0x05;
+constexpr uint8_t TMC_WRITE_BIT = 0x80;
+constexpr uint8_t TMC_REPLY_ADDRESS = 0xFF;
+constexpr size_t TMC_WRITE_DATAGRAM_SIZE = 8;
+constexpr size_t TMC_READ_REQUEST_SIZE = 4;
+constexpr size_t TMC_REPLY_SIZE = TMC_WRITE_DATAGRAM_SIZE;
+
+// The datasheet's CRC8 (poly 0x07) shifts each byte in LSB first. That is a reflected CRC8 with poly 0xE0, whose
+// register comes out bit-reversed: one table lookup per byte, and a single bit reversal at the end.
+constexpr uint8_t tmc_reverse_bits(uint8_t byte) {
+	byte = (byte & 0xF0) >> 4 | (byte & 0x0F) << 4;
+	byte = (byte & 0xCC) >> 2 | (byte & 0x33) << 2;
+	return (byte & 0xAA) >> 1 | (byte & 0x55) << 1;
+}
+
+constexpr std::array<uint8_t, 256> make_tmc_crc8_table() {
+	std::array<uint8_t, 256> table {};
+	for (uint16_t i = 0; i < 256; ++i) {
+		uint8_t crc = i;
+		for (uint8_t bit = 0; bit < 8; ++bit) {
+			crc = (crc & 0x01) ? (crc >> 1) ^ 0xE0 : crc >> 1;
+		}
+		table[i] = crc;
+	}
+	return table;
+}
+
+constexpr std::array<uint8_t, 256> TMC_CRC8_TABLE = make_tmc_crc8_table();
+
+constexpr uint8_t tmc_crc8(const uint8_t *data, size_t len) {
+	uint8_t crc = 0;
+	for (size_t i = 0; i < len; ++i) {
+		crc = TMC_CRC8_TABLE[crc ^ data[i]];
+	}
+	return tmc_reverse_bits(crc);
+}
+
+// `dst` must hold TMC_WRITE_DATAGRAM_SIZE bytes.
+constexpr void tmc_build_write(uint8_t *dst, uint8_t serial_address,
+		uint8_t register_address, uint32_t data) {
+	dst[0] = TMC_SYNC;
+	dst[1] = serial_address;
+	dst[2] = register_address | TMC_WRITE_BIT;
+	dst[3] = data >> 24;
+	dst[4] = data >> 16;
+	dst[5] = data >> 8;
+	dst[6] = data;
+	dst[7] = tmc_crc8(dst, TMC_WRITE_DATAGRAM_SIZE - 1);
+}
+
+// `dst` must hold TMC_READ_REQUEST_SIZE bytes.
+constexpr void tmc_build_read_request(uint8_t *dst, uint8_t serial_address,
+		uint8_t register_address) {
+	dst[0] = TMC_SYNC;
+	dst[1] = serial_address;
+	dst[2] = register_address;
+	dst[3] = tmc_crc8(dst, TMC_READ_REQUEST_SIZE - 1);
+}
+
+// Register value from a read reply, or false if the reply is corrupted or doesn't answer `register_address`.
+constexpr bool tmc_parse_reply(const uint8_t *reply, uint8_t register_address,
+		uint32_t &data) {
+	if ((reply[0] & 0x0F) != TMC_SYNC || reply[1] != TMC_REPLY_ADDRESS
+			|| reply[2] != register_address
+			|| tmc_crc8(reply, TMC_REPLY_SIZE - 1) != reply[TMC_REPLY_SIZE - 1])
+		return false;
+	data = (uint32_t(reply[3]) << 24) | (uint32_t(reply[4]) << 16)
+			| (uint32_t(reply[5]) << 8) | reply[6];
+	return true;
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cstdint>
+
+// TMC2209 register map. Each field knows its register and where it sits in it, so reading or updating one comes down
+// to a shift and a mask on the register's 32-bit value, with no compiler-dependent bitfield layout in between.
+
+template<typename F>
+struct FieldValue {
+	uint32_t value;
+};
+
+template<uint8_t ADDRESS_, uint8_t OFFSET, uint8_t WIDTH>
+struct Field {
+	static_assert(WIDTH > 0 && OFFSET + WIDTH <= 32,
+			"A field must fit in its 32-bit register");
+
+	static constexpr uint8_t ADDRESS = ADDRESS_;
+	static constexpr uint32_t MAX = WIDTH == 32 ? 0xFFFFFFFF : (1u << WIDTH) - 1;
+	static constexpr uint32_t MASK = MAX << OFFSET;
+
+	static constexpr uint32_t get(uint32_t reg) {
+		return (reg & MASK) >> OFFSET;
+	}
+	// For two's complement fields.
+	static constexpr int32_t get_signed(uint32_t reg) {
+		const uint32_t value = get(reg);
+		return value & (1u << (WIDTH - 1)) ?
+				static_cast<int32_t>(value | ~MAX) : static_cast<int32_t>(value);
+	}
+	// Values too wide for the field are cut to it, they don't spill into the next one.
+	static constexpr void set(uint32_t &reg, uint32_t value) {
+		reg = (reg & ~MASK) | ((value << OFFSET) & MASK);
+	}
+	static constexpr FieldValue<Field> of(uint32_t value) {
+		return {value};
+	}
+};
+
+// Several fields of one register updated at once, e.g. update(reg, CHOPCONF::toff::of(3), CHOPCONF::tbl::of(2)).
+template<typename First, typename ... Rest>
+constexpr uint32_t update(uint32_t reg, FieldValue<First> first,
+		FieldValue<Rest> ... rest) {
+	static_assert((... && (Rest::ADDRESS == First::ADDRESS)),
+			"Fields updated together must be in the same register");
+	First::set(reg, first.value);
+	(Rest::set(reg, rest.value), ...);
+	return reg;
+}
+
+// Register value made of the given fields, the others zero.
+template<typename ... Fields>
+constexpr uint32_t compose(FieldValue<Fields> ... values) {
+	return update(0, values...);
+}
+
+namespace tmc2209_reg {
+
+// General configuration registers.
+struct GCONF {
+	static constexpr uint8_t ADDRESS = 0x00;
+	using i_scale_analog = Field<ADDRESS, 0, 1>;
+	using internal_rsense = Field<ADDRESS, 1, 1>;
+	using en_spreadcycle = Field<ADDRESS, 2, 1>;
+	using shaft = Field<ADDRESS, 3, 1>;
+	using index_otpw = Field<ADDRESS, 4, 1>;
+	using index_step = Field<ADDRESS, 5, 1>;
+	using pdn_disable = Field<ADDRESS, 6, 1>;
+	using mstep_reg_select = Field<ADDRESS, 7, 1>;
+	using multistep_filt = Field<ADDRESS, 8, 1>;
+	using test_mode = Field<ADDRESS, 9, 1>;
+};
+
+// Write 1 to clear.
+struct GSTAT {
+	static constexpr uint8_t ADDRESS = 0x01;
+	using reset = Field<ADDRESS, 0, 1>;
+	using drv_err = Field<ADDRESS, 1, 1>;
+	using uv_cp = Field<ADDRESS, 2, 1>;
+};
+
+struct IFCNT {
+	static constexpr uint8_t ADDRESS = 0x02;
+	using ifcnt = Field<ADDRESS, 0, 8>;
+};
+
+struct NODECONF {
+	static constexpr uint8_t ADDRESS = 0x03;
+	using senddelay = Field<ADDRESS, 8, 4>;
+};
+
+struct IOIN {
+	static constexpr uint8_t ADDRESS = 0x06;
+	using enn = Field<ADDRESS, 0, 1>;
+	using ms1 = Field<ADDRESS, 2, 1>;
+	using ms2 = Field<ADDRESS, 3, 1>;
+	using diag = Field<ADDRESS, 4, 1>;
+	using pdn_uart = Field<ADDRESS, 6, 1>;
+	using step = Field<ADDRESS, 7, 1>;
+	using spread_en = Field<ADDRESS, 8, 1>;
+	using dir = Field<ADDRESS, 9, 1>;
+	using version = Field<ADDRESS, 24, 8>;
+};
+
+// Velocity dependent control.
+struct IHOLD_IRUN {
+	static constexpr uint8_t ADDRESS = 0x10;
+	using ihold = Field<ADDRESS, 0, 5>;
+	using irun = Field<ADDRESS, 8, 5>;
+	using iholddelay = Field<ADDRESS, 16, 4>;
+};
+
+struct TPOWERDOWN {
+	static constexpr uint8_t ADDRESS = 0x11;
+	using tpowerdown = Field<ADDRESS, 0, 8>;
+};
+
+struct TSTEP {
+	static constexpr uint8_t ADDRESS = 0x12;
+	using tstep = Field<ADDRESS, 0, 20>;
+};
+
+struct TPWMTHRS {
+	static constexpr uint8_t ADDRESS = 0x13;
+	using tpwmthrs = Field<ADDRESS, 0, 20>;
+};
+
+struct TCOOLTHRS {
+	static constexpr uint8_t ADDRESS = 0x14;
+	using tcoolthrs = Field<ADDRESS, 0, 20>;
+};
+
+struct VACTUAL {
+	static constexpr uint8_t ADDRESS = 0x22;
+	using vactual = Field<ADDRESS, 0, 24>;
+};
+
+// StallGuard and CoolStep.
+struct SGTHRS {
+	static constexpr uint8_t ADDRESS = 0x40;
+	using sgthrs = Field<ADDRESS, 0, 8>;
+};
+
+struct SG_RESULT {
+	static constexpr uint8_t ADDRESS = 0x41;
+	using sg_result = Field<ADDRESS, 0, 10>;
+};
+
+struct COOLCONF {
+	static constexpr uint8_t ADDRESS = 0x42;
+	using semin = Field<ADDRESS, 0, 4>;
+	using seup = Field<ADDRESS, 5, 2>;
+	using semax = Field<ADDRESS, 8, 4>;
+	using sedn = Field<ADDRESS, 13, 2>;
+	using seimin = Field<ADDRESS, 15, 1>;
+};
+
+// Microstepping.
+struct MSCNT {
+	static constexpr uint8_t ADDRESS = 0x6A;
+	using mscnt = Field<ADDRESS, 0, 10>;
+};
+
+struct MSCURACT {
+	static constexpr uint8_t ADDRESS = 0x6B;
+	using cur_a = Field<ADDRESS, 0, 9>;
+	using cur_b = Field<ADDRESS, 16, 9>;
+};
+
+// Driver.
+struct CHOPCONF {
+	static constexpr uint8_t ADDRESS = 0x6C;
+	using toff = Field<ADDRESS, 0, 4>;
+	using hstrt = Field<ADDRESS, 4, 3>;
+	using hend = Field<ADDRESS, 7, 4>;
+	using tbl = Field<ADDRESS, 15, 2>;
+	using vsense = Field<ADDRESS, 17, 1>;
+	using mres = Field<ADDRESS, 24, 4>;
+	using intpol = Field<ADDRESS, 28, 1>;
+	using dedge = Field<ADDRESS, 29, 1>;
+	using diss2g = Field<ADDRESS, 30, 1>;
+	using diss2vs = Field<ADDRESS, 31, 1>;
+};
+
+struct DRV_STATUS {
+	static constexpr uint8_t ADDRESS = 0x6F;
+	using otpw = Field<ADDRESS, 0, 1>;
+	using ot = Field<ADDRESS, 1, 1>;
+	using s2ga = Field<ADDRESS, 2, 1>;
+	using s2gb = Field<ADDRESS, 3, 1>;
+	using s2vsa = Field<ADDRESS, 4, 1>;
+	using s2vsb = Field<ADDRESS, 5, 1>;
+	using ola = Field<ADDRESS, 6, 1>;
+	using olb = Field<ADDRESS, 7, 1>;
+	using t120 = Field<ADDRESS, 8, 1>;
+	using t143 = Field<ADDRESS, 9, 1>;
+	using t150 = Field<ADDRESS, 10, 1>;
+	using t157 = Field<ADDRESS, 11, 1>;
+	using cs_actual = Field<ADDRESS, 16, 5>;
+	using stealth = Field<ADDRESS, 30, 1>;
+	using stst = Field<ADDRESS, 31, 1>;
+};
+
+struct PWMCONF {
+	static constexpr uint8_t ADDRESS = 0x70;
+	using pwm_ofs = Field<ADDRESS, 0, 8>;
+	using pwm_grad = Field<ADDRESS, 8, 8>;
+	using pwm_freq = Field<ADDRESS, 16, 2>;
+	using pwm_autoscale = Field<ADDRESS, 18, 1>;
+	using pwm_autograd = Field<ADDRESS, 19, 1>;
+	using freewheel = Field<ADDRESS, 20, 2>;
+	using pwm_reg = Field<ADDRESS, 24, 4>;
+	using pwm_lim = Field<ADDRESS, 28, 4>;
+};
+
+struct PWM_SCALE {
+	static constexpr uint8_t ADDRESS = 0x71;
+	using pwm_scale_sum = Field<ADDRESS, 0, 8>;
+	using pwm_scale_auto = Field<ADDRESS, 16, 9>; // Signed.
+};
+
+struct PWM_AUTO {
+	static constexpr uint8_t ADDRESS = 0x72;
+	using pwm_ofs_auto = Field<ADDRESS, 0, 8>;
+	using pwm_grad_auto = Field<ADDRESS, 16, 8>;
+};
+
+// Checked against the datasheet's register map (TMC2209 datasheet rev. 1.09, section 5).
+static_assert(GCONF::multistep_filt::MASK == 0x00000100, "GCONF");
+static_assert(GSTAT::uv_cp::MASK == 0x00000004, "GSTAT");
+static_assert(NODECONF::senddelay::MASK == 0x00000F00, "NODECONF");
+static_assert(IOIN::version::MASK == 0xFF000000, "IOIN");
+static_assert(IHOLD_IRUN::irun::MASK == 0x00001F00
+		&& IHOLD_IRUN::iholddelay::MASK == 0x000F0000, "IHOLD_IRUN");
+static_assert(TSTEP::tstep::MASK == 0x000FFFFF, "TSTEP");
+static_assert(VACTUAL::vactual::MASK == 0x00FFFFFF, "VACTUAL");
+static_assert(SG_RESULT::sg_result::MASK == 0x000003FF, "SG_RESULT");
+static_assert(COOLCONF::seup::MASK == 0x00000060
+		&& COOLCONF::sedn::MASK == 0x00006000
+		&& COOLCONF::seimin::MASK == 0x00008000, "COOLCONF");
+static_assert(CHOPCONF::tbl::MASK == 0x00018000
+		&& CHOPCONF::mres::MASK == 0x0F000000
+		&& CHOPCONF::diss2vs::MASK == 0x80000000, "CHOPCONF");
+static_assert(DRV_STATUS::cs_actual::MASK == 0x001F0000
+		&& DRV_STATUS::stst::MASK == 0x80000000, "DRV_STATUS");
+static_assert(PWMCONF::freewheel::MASK == 0x00300000
+		&& PWMCONF::pwm_lim::MASK == 0xF0000000, "PWMCONF");
+static_assert(PWM_SCALE::pwm_scale_auto::MASK == 0x01FF0000, "PWM_SCALE");
+
+// Reset defaults decode to the datasheet's field defaults.
+static_assert(CHOPCONF::toff::get(0x10000053) == 3
+		&& CHOPCONF::hstrt::get(0x10000053) == 5
+		&& CHOPCONF::hend::get(0x10000053) == 0
+		&& CHOPCONF::intpol::get(0x10000053) == 1, "CHOPCONF reset value");
+static_assert(PWMCONF::pwm_ofs::get(0xC10D0024) == 36
+		&& PWMCONF::pwm_freq::get(0xC10D0024) == 1
+		&& PWMCONF::pwm_autoscale::get(0xC10D0024) == 1
+		&& PWMCONF::pwm_autograd::get(0xC10D0024) == 1
+		&& PWMCONF::pwm_reg::get(0xC10D0024) == 1
+		&& PWMCONF::pwm_lim::get(0xC10D0024) == 12, "PWMCONF reset value");
+
+}
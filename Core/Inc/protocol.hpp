@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// COBS framing for the host link: each frame is COBS(opcode | payload | CRC16 of opcode & payload, little endian),
+// terminated by a 0x00 delimiter. Since 0x00 can never appear inside an encoded frame, a corrupted frame is simply
+// dropped at the next delimiter.
+constexpr uint8_t FRAME_DELIMITER = 0x00;
+constexpr size_t FRAME_CRC_SIZE = 2;
+constexpr size_t MAX_FRAME_PAYLOAD = 96;
+constexpr size_t MAX_DECODED_FRAME_SIZE = 1 + MAX_FRAME_PAYLOAD + FRAME_CRC_SIZE;
+// COBS adds one overhead byte per 254 bytes of data, plus the delimiter.
+constexpr size_t MAX_ENCODED_FRAME_SIZE = MAX_DECODED_FRAME_SIZE
+		+ MAX_DECODED_FRAME_SIZE / 254 + 2;
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF);
+
+// Encode `len` bytes into `dst`, including the trailing delimiter. Returns the number of bytes written.
+// `dst` must hold at least len + len / 254 + 2 bytes.
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst);
+
+// Decode an encoded frame (without its delimiter) into `dst`, which may alias `src`.
+// Returns the decoded length, or 0 if the frame is malformed.
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst);
+
+// Build a complete frame for `opcode` and `payload` into `dst`, which must hold MAX_ENCODED_FRAME_SIZE bytes.
+// Returns the number of bytes to send, or 0 if the payload is too large.
+size_t frame_encode(uint8_t opcode, const uint8_t *payload, size_t len,
+		uint8_t *dst);
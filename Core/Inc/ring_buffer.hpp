@@ -1,63 +1,162 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
+// Lock-free single-producer/single-consumer ring buffer.
+// The producer (an ISR, or a DMA channel through set_head) only ever writes head_, the consumer (the main loop) moves
+// tail_, except when a DMA producer has overrun it (see set_head). Both indices run freely and are only masked when
+// indexing the storage, so all N slots are usable.
+template<size_t N, typename T = uint8_t>
 class RingBuffer {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
 public:
-	static constexpr size_t SIZE = 256;
+	static constexpr size_t SIZE = N;
 	static constexpr size_t MASK = SIZE - 1;  // For fast mod operations.
 
-	RingBuffer() :
-			head_(0), tail_(0) {
+	// A contiguous region of stored elements.
+	struct Span {
+		const T *data;
+		size_t size;
+	};
+
+	// Stored elements in FIFO order: `second` is only non-empty when they wrap around the end of the storage. `tail` is
+	// where they start, for commit to count from even if the producer has resynced the consumer since.
+	struct Spans {
+		Span first;
+		Span second;
+		size_t tail;
+
+		size_t size() const {
+			return first.size + second.size;
+		}
+
+		// Copy `n` elements starting `offset` elements in into `dst`.
+		// Returns false (copying nothing) if the spans hold fewer than offset + n elements.
+		bool copy(T *dst, size_t n, size_t offset = 0) const {
+			if (size() < offset + n)
+				return false;
+			if (offset < first.size) {
+				const size_t from_first = std::min(n, first.size - offset);
+				std::memcpy(dst, first.data + offset, from_first * sizeof(T));
+				std::memcpy(dst + from_first, second.data,
+						(n - from_first) * sizeof(T));
+			} else {
+				std::memcpy(dst, second.data + (offset - first.size),
+						n * sizeof(T));
+			}
+			return true;
+		}
+	};
+
+	// Producer side.
+
+	// Push is called from the ISR. If the buffer is full the element is dropped and counted, since overwriting the
+	// oldest data would mean touching the consumer's index.
+	bool push(const T &value) {
+		const size_t head = head_.load(std::memory_order_relaxed);
+		if (head - tail_.load(std::memory_order_acquire) == SIZE) {
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		buffer_[head & MASK] = value;
+		head_.store(head + 1, std::memory_order_release);
+		return true;
 	}
 
-	// Push is called from the ISR.
-	void push(uint8_t byte) {
-		buffer_[head_] = byte;
-		head_ = (head_ + 1) & MASK;
-		// Handle overflow: here we overwrite the oldest data.
-		if (head_ == tail_) {
-			tail_ = (tail_ + 1) & MASK;
+	// Backing storage, for producers that write into the buffer directly (i.e. circular DMA).
+	T* storage() {
+		return buffer_;
+	}
+
+	// Publish elements written directly into storage() up to (excluding) storage index `pos`.
+	// Like push, this is called from the ISR. A DMA producer cannot be held back, so if it has lapped the consumer the
+	// overwritten elements are counted as dropped, and the producer resyncs the consumer onto the oldest element still
+	// intact: what follows the tail is then always in order, if not always complete. Anything the consumer was still
+	// reading when that happened may be garbled, and is for the protocol's checks to reject.
+	void set_head(size_t pos) {
+		const size_t head = head_.load(std::memory_order_relaxed);
+		const size_t new_head = head + ((pos - head) & MASK);
+		const size_t tail = tail_.load(std::memory_order_acquire);
+		if (new_head - tail > SIZE) {
+			dropped_.fetch_add(new_head - SIZE - tail, std::memory_order_relaxed);
+			advance_tail(new_head - SIZE);
 		}
+		head_.store(new_head, std::memory_order_release);
 	}
 
-	// Pop removes the next byte and returns it.
-	// Returns true if a byte was available.
-	bool pop(uint8_t &byte) {
-		if (empty())
+	// Consumer side.
+
+	// Pop removes the next element and returns it.
+	// Returns true if an element was available.
+	bool pop(T &value) {
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		if (head_.load(std::memory_order_acquire) == tail)
 			return false;
-		byte = buffer_[tail_];
-		tail_ = (tail_ + 1) & MASK;
+		value = buffer_[tail & MASK];
+		tail_.store(tail + 1, std::memory_order_release);
 		return true;
 	}
 
-	// Returns the number of bytes currently stored.
+	// Returns the number of elements currently stored.
 	size_t available() const {
-		if (head_ >= tail_)
-			return head_ - tail_;
-		else
-			return SIZE - tail_ + head_;
+		return std::min(
+				head_.load(std::memory_order_acquire)
+						- tail_.load(std::memory_order_relaxed), SIZE);
 	}
 
 	bool empty() const {
-		return head_ == tail_;
+		return available() == 0;
 	}
 
-	// Peek at both the next byte and the second-next byte
-	bool peek_two(uint8_t &firstByte, uint8_t &secondByte) const {
-		if (available() < 2)  // Ensure at least two bytes are available
-			return false;
-		firstByte = buffer_[tail_];
-		secondByte = buffer_[(tail_ + 1) & MASK];
-		return true;
+	// Up to `max` of the next stored elements, without consuming them. Release them with commit once done.
+	Spans peek_span(size_t max = SIZE) const {
+		// One load of the tail for both the count and the spans, which a resync in between would have disagree.
+		const size_t tail = tail_.load(std::memory_order_acquire);
+		const size_t count = std::min(
+				std::min(head_.load(std::memory_order_acquire) - tail, SIZE),
+				max);
+		const size_t start = tail & MASK;
+		const size_t first = std::min(count, SIZE - start);
+		return { { &buffer_[start], first }, { &buffer_[0], count - first },
+				tail };
+	}
+
+	// Copy `n` elements starting `offset` elements past the tail into `dst`, without consuming them.
+	// Returns false (copying nothing) if fewer than offset + n elements are stored.
+	bool peek(T *dst, size_t n, size_t offset = 0) const {
+		return peek_span().copy(dst, n, offset);
 	}
 
-	void discard(const size_t n = 1) {
-		tail_ = (tail_ + std::min(available(), n)) & MASK;
+	// Consume the first `n` of the `peeked` elements, once decoded. Counted from where they were peeked: if the
+	// producer has resynced the consumer since, the elements it skipped are already counted as dropped, and those
+	// after the resync point up to `n` are the ones the consumer has just read, garbled or not.
+	void commit(const Spans &peeked, size_t n) {
+		advance_tail(peeked.tail + std::min(peeked.size(), n));
+	}
+
+	// Number of elements lost because the buffer was full.
+	uint32_t dropped() const {
+		return dropped_.load(std::memory_order_relaxed);
 	}
 
 private:
-	volatile uint8_t buffer_[SIZE];
-	volatile size_t head_;
-	volatile size_t tail_;
+	T buffer_[SIZE];
+	std::atomic<size_t> head_ { 0 };
+	std::atomic<size_t> tail_ { 0 };
+	std::atomic<uint32_t> dropped_ { 0 };
+
+	// Moves the tail up to `to`, unless it is already past it. Both sides can move the tail (the producer only when it
+	// resyncs the consumer), so it never goes backwards over elements the other side has already let go of.
+	void advance_tail(size_t to) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		while (static_cast<std::ptrdiff_t>(to - tail) > 0
+				&& !tail_.compare_exchange_weak(tail, to,
+						std::memory_order_release, std::memory_order_relaxed)) {
+		}
+	}
 };
@@ -4,31 +4,84 @@
 #include "stm32h5xx_hal.h"
 #include "stm32h5xx_nucleo.h"
 #include "peripherals/TMC2209.hpp"
+#include "peripherals/tmc2209_bus.hpp"
+#include "peripherals/as5600_bus.hpp"
 #include "peripherals/pca9685.h"
 #include "peripherals/lcd1602.hpp"
 #include "commands.hpp"
 #include "constants.hpp"
 #include "main.h"
 #include "ring_buffer.hpp"
+#include "protocol.hpp"
+#include "tx_queue.hpp"
+#include "velocity_commit.hpp"
+#include "stepper_status_poller.hpp"
+#include "encoder_sampler.hpp"
+
+#pragma pack(push, 1)
+// Pushed with opcode 'w' at the subscribed rate.
+struct WheelTelemetry {
+	uint32_t seq;
+	uint32_t timestamp_us; // See timebase.hpp.
+	uint32_t skipped; // Samples dropped so far because the TX queue was backed up.
+	WheelInfo wheel_info;
+	float tracking_error[WHEEL_COUNT]; // rad/s, see VelocityCommit::get_tracking_errors().
+};
+// Reply to the 'b' command. Times are from reset, or near enough: the HAL tick starts at HAL_Init().
+struct BootStats {
+	uint32_t ready_ms; // Ready for commands.
+	uint32_t drivers_configured_ms; // All of the stepper drivers' configuration went out, 0 until then or if it failed.
+	uint8_t readback_failed; // Bit per driver whose configuration didn't read back right, if read back at all.
+	uint8_t config_failed; // Some of the drivers' configuration couldn't be queued or failed on the bus.
+};
+#pragma pack(pop)
 
 class Robot {
 public:
 	void init(UART_HandleTypeDef *tmc_uart, UART_HandleTypeDef *usb_uart,
-			I2C_HandleTypeDef *i2c);
+			I2C_HandleTypeDef *i2c, TIM_HandleTypeDef *telemetry_tim,
+			TIM_HandleTypeDef *motion_tim, TIM_HandleTypeDef *step_tim,
+			TIM_HandleTypeDef *encoder_tim);
 
 	void recv_command(void);
+	void service_steppers(void); // Background bus work, called from the main loop.
+	void start_usb_rx(void);
+	void send_response(uint8_t opcode, const void *data, size_t len);
+
+	HAL_StatusTypeDef start_telemetry(uint16_t rate_hz);
+	HAL_StatusTypeDef stop_telemetry(void);
+	void send_telemetry(void); // Called from the telemetry timer's interrupt.
 
 	UART_HandleTypeDef *tmc_uart_ = nullptr;
 	UART_HandleTypeDef *usb_uart_ = nullptr;
 	I2C_HandleTypeDef *i2c_ = nullptr;
+	TIM_HandleTypeDef *telemetry_tim_ = nullptr;
+	TIM_HandleTypeDef *motion_tim_ = nullptr;
+	TIM_HandleTypeDef *step_tim_ = nullptr;
+	TIM_HandleTypeDef *encoder_tim_ = nullptr;
 
+	TMC2209Bus tmc_bus_;
 	TMC2209 stepper1_, stepper2_, stepper3_;
+	StepGenerator step_generator_;
+	VelocityCommit velocity_commit_;
+	StepperStatusPoller stepper_status_poller_;
+	AS5600Bus encoder_bus_; // Shared with the LCD, which has to lock() it.
 	WheelSpeedsEstimator wheel_speeds_estimator_;
+	EncoderSampler encoder_sampler_;
 	LCD1602_I2C lcd_;
 
-	RingBuffer usb_rx_buf_;
-	uint8_t usb_rx_temp_;
+	RingBuffer<USB_RX_BUF_SIZE> usb_rx_buf_;
+	uint32_t usb_rx_bad_frames_ = 0;
+	TxQueue usb_tx_queue_;
+	uint32_t telemetry_seq_ = 0;
+	uint32_t last_write_verify_ms_ = 0;
+	BootStats boot_stats_ { };
+	volatile uint8_t driver_config_bursts_ = 0; // Completed, see on_drivers_configured.
 
 private:
-	template<typename T> void recv_payload_and_execute(void);
+	static void on_drivers_configured(void *context, bool ok, uint32_t data);
+	void queue_frame(uint8_t opcode, const void *data, size_t len,
+			TxQueue::Kind kind);
+	void recv_legacy_command(void);
+	void recv_frame(void);
 };
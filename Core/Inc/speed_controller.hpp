@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cmath>
+
+// Gains for a SpeedController, in the velocity units it is stepped in: kp per unit of error, ki per unit of error and
+// second. The correction is held within ±max_correction, 0 turns it off.
+struct SpeedLoopGains {
+	float kp;
+	float ki;
+	float max_correction;
+};
+
+// Feed-forward plus PI speed loop. The reference goes out as it is, and the PI only makes up for what the wheel
+// doesn't follow: slip, load, the driver's clock being off. The integral stops growing while the correction is
+// clamped, unless the error pulls it back in, so it doesn't wind up while the wheel can't keep up.
+class SpeedController {
+public:
+	float step(float reference, float measured, const SpeedLoopGains &gains,
+			float dt) {
+		const float limit = gains.max_correction;
+		error_ = reference - measured;
+		const float integral = std::fmax(-limit,
+				std::fmin(integral_ + gains.ki * error_ * dt, limit));
+		const float unclamped = gains.kp * error_ + integral;
+		const float correction = std::fmax(-limit, std::fmin(unclamped, limit));
+		if (correction == unclamped || (unclamped > limit) != (error_ > 0)) {
+			integral_ = integral;
+		}
+		return reference + correction;
+	}
+
+	// For when the loop is open: the next step starts from scratch.
+	void reset(void) {
+		integral_ = 0;
+		error_ = 0;
+	}
+
+	// Reference minus measured, as of the last step.
+	float error(void) const {
+		return error_;
+	}
+
+private:
+	float integral_ = 0;
+	float error_ = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include "stm32h5xx_hal.h"
+#include "constants.hpp"
+
+// STEP pulses for the drivers' STEP/DIR interface, for all the wheels from one 32-bit timer. Each wheel has its own
+// channel in output compare toggle mode, so each runs at its own rate: every compare event toggles the pin, and the
+// interrupt moves that channel's compare point on by half a step period. The steps are counted as they go out.
+class StepGenerator {
+public:
+	// The timer counts at the core clock, with channels 1 to WHEEL_COUNT in toggle mode.
+	void init(TIM_HandleTypeDef *tim);
+
+	// Steps per second, signed for the direction. Takes effect at the next edge, or straight away if that is sooner
+	// than the new rate would have it.
+	void set_rate(uint8_t wheel, float steps_per_s);
+
+	// Called from the timer's interrupt.
+	void on_compare(uint8_t wheel);
+
+	void get_positions(int32_t *steps);
+
+private:
+	struct Channel {
+		volatile uint32_t half_period;  // In timer ticks, 0 when stopping.
+		volatile bool forward;
+		bool running;
+		bool high;
+		volatile int32_t position;
+	};
+
+	TIM_HandleTypeDef *tim_ = nullptr;
+	uint32_t ticks_per_s_ = 0;
+	Channel channels_[WHEEL_COUNT] { };
+
+	void start(uint8_t wheel);
+	void stop(uint8_t wheel);
+	void set_output_mode(uint8_t wheel, uint32_t mode);
+	volatile uint32_t& compare(uint8_t wheel);
+};
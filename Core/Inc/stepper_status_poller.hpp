@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#include "constants.hpp"
+#include "peripherals/TMC2209.hpp"
+#include "peripherals/tmc2209_bus.hpp"
+#include "velocity_commit.hpp"
+
+#pragma pack(push, 1)
+// Latest diagnostics of a driver, as raw register values.
+struct StepperStatus {
+	uint32_t drv_status;
+	uint32_t tstep;
+	uint32_t pwm_scale;
+	uint16_t sg_result;
+	uint32_t timestamp_ms; // When the oldest of the readings above was taken, 0 until they've all been read once.
+};
+
+// Reply to the 'd' command.
+struct StepperStatusReport {
+	StepperStatus steppers[WHEEL_COUNT];
+};
+#pragma pack(pop)
+
+// Keeps the drivers' diagnostics registers cached, reading them one at a time and round robin in the gaps between
+// other bus traffic. A read only starts on an idle bus with enough time left before the next velocity commit, so the
+// commits never wait for more than the read in flight, if they do at all.
+class StepperStatusPoller {
+public:
+	void init(TMC2209Bus *bus, TMC2209 *const *steppers,
+			const VelocityCommit *velocity_commit);
+
+	// Thread mode, called from the main loop.
+	void poll(void);
+
+	StepperStatusReport get_report(void);
+
+private:
+	static constexpr uint8_t REGISTER_COUNT = 4;
+	static constexpr uint8_t REGISTERS[REGISTER_COUNT] = {
+			TMC2209::ADDRESS_DRV_STATUS, TMC2209::ADDRESS_SG_RESULT,
+			TMC2209::ADDRESS_TSTEP, TMC2209::ADDRESS_PWM_SCALE };
+
+	struct Reading {
+		uint32_t value;
+		uint32_t timestamp_ms;
+	};
+
+	TMC2209Bus *bus_ = nullptr;
+	TMC2209 *steppers_[WHEEL_COUNT] { };
+	const VelocityCommit *velocity_commit_ = nullptr;
+
+	Reading readings_[WHEEL_COUNT][REGISTER_COUNT] { };
+	uint8_t next_wheel_ = 0, next_register_ = 0;
+	volatile bool in_flight_ = false;
+
+	static void on_reply(void *context, bool ok, uint32_t data);
+};
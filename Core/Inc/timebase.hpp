@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// Free-running microsecond clock for timestamping, from the cycle counter. 32 bits wrap every 71 minutes, so times
+// are only compared through us_between() and us_before(), never with < or by subtracting them as signed values.
+void timebase_init(void);
+uint32_t micros(void);
+
+// Called from SysTick, to carry the cycle counter's wraps over before it has a chance to wrap twice.
+extern "C" void timebase_tick(void);
+
+// From `from` to `to`, across a wrap if there is one in between. Right for intervals up to 71 minutes.
+inline uint32_t us_between(uint32_t from, uint32_t to) {
+	return to - from;
+}
+
+// Whether `a` comes before `b`, for times less than 35 minutes apart.
+inline bool us_before(uint32_t a, uint32_t b) {
+	return static_cast<int32_t>(a - b) < 0;
+}
+
+// Halfway between two times, across a wrap if there is one in between.
+inline uint32_t us_midpoint(uint32_t from, uint32_t to) {
+	return from + us_between(from, to) / 2;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "stm32h5xx_hal.h"
+#include "constants.hpp"
+#include "protocol.hpp"
+
+// Outbound frame queue for a UART, drained in the background by DMA.
+// Frames are copied into fixed slots and sent in FIFO order, one DMA transfer each, with the next transfer started
+// from the completion interrupt. Replies are never dropped: if the queue is full, the oldest telemetry frame waiting
+// to be sent is evicted, and failing that send() waits for a slot to free up. Telemetry is dropped (and counted)
+// rather than waited for. A reply the UART refuses to start sending stays queued and is retried.
+class TxQueue {
+public:
+	enum class Kind : uint8_t {
+		REPLY, TELEMETRY
+	};
+
+	static constexpr size_t FRAME_CAPACITY = MAX_ENCODED_FRAME_SIZE;
+
+	void init(UART_HandleTypeDef *huart);
+
+	// Queue a frame for sending. May be called from interrupts for telemetry, but not for replies.
+	// Returns false if the frame was dropped.
+	bool send(const uint8_t *data, size_t len, Kind kind);
+
+	// To be called from HAL_UART_TxCpltCallback.
+	void on_tx_complete(void);
+	// To be called from the main loop: retries a transfer the UART refused, if nothing else has since.
+	void poll(void);
+
+	uint32_t dropped_telemetry() const {
+		return dropped_telemetry_;
+	}
+	// Transfers the UART refused to start.
+	uint32_t failed_transfers() const {
+		return failed_transfers_;
+	}
+
+private:
+	enum class State : uint8_t {
+		FREE, QUEUED, SENDING
+	};
+
+	struct Slot {
+		uint8_t data[FRAME_CAPACITY];
+		uint16_t len;
+		Kind kind;
+		volatile State state;
+		uint32_t seq;
+	};
+
+	UART_HandleTypeDef *huart_ = nullptr;
+	Slot slots_[USB_TX_QUEUE_LENGTH] { };
+	uint32_t next_seq_ = 0;
+	volatile bool sending_ = false;
+	volatile uint32_t dropped_telemetry_ = 0;
+	volatile uint32_t failed_transfers_ = 0;
+
+	Slot* claim_slot(void);
+	void start_next(void);
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+#include "stm32h5xx_hal.h"
+#include "constants.hpp"
+#include "peripherals/TMC2209.hpp"
+#include "peripherals/tmc2209_bus.hpp"
+#include "velocity_ramp.hpp"
+#include "speed_controller.hpp"
+#include "step_generator.hpp"
+#include "wheel_speeds_estimator.hpp"
+
+#pragma pack(push, 1)
+// Reply to the 'v' command.
+struct VelocityCommitStats {
+	uint32_t commits;
+	uint32_t last_skew_us;     // From the first to the last driver taking its new VACTUAL, timed on the echo.
+	uint32_t max_skew_us;
+	uint32_t last_latency_us;  // From the commit tick to the last driver taking its new VACTUAL.
+	uint32_t max_latency_us;
+};
+#pragma pack(pop)
+
+// Owns the wheels' VACTUAL, and sends it to all the drivers together. The command handlers set target velocities,
+// which each wheel's ramp moves toward on every timer tick, and the wheels whose VACTUAL changed go out as one DMA
+// burst, with the datagrams back to back. Each driver applies its datagram as soon as it has the whole of it, so on
+// a shared bus the wheels still start one datagram time (0.7 ms at 115200 baud) apart: the burst only takes
+// everything else out from between them, and the timer makes the commit instant regular.
+// With the STEP/DIR backend, the ramped velocities go to the step generator instead, all at once and without
+// touching the UART, and VACTUAL stays at 0.
+// While the encoders' speed estimates are fresh, each wheel's ramped velocity is corrected on the same tick by a PI
+// loop on what the wheel actually does.
+class VelocityCommit {
+public:
+	void init(TMC2209Bus *bus, TMC2209 *const *steppers,
+			StepGenerator *step_generator, WheelSpeedsEstimator *estimator,
+			TIM_HandleTypeDef *tim);
+
+	void set_backend(MotionBackend backend);
+
+	// VACTUAL for each wheel to ramp to, from the next tick.
+	void set_targets(const int32_t *vactual);
+	// Emergency stop: every wheel to 0 on the spot, past the ramp limits and with the speed loops reset, and a
+	// VACTUAL 0 burst sent straight away rather than on the next tick. From thread mode.
+	void stop_now(void);
+	// In VACTUAL units per second and per second squared, 0 for no limit.
+	void set_ramp_limits(const RampLimits &limits);
+	// In VACTUAL units, a max correction of 0 opens the loop.
+	void set_speed_loop_gains(const SpeedLoopGains &gains);
+
+	// Called from the timer's interrupt.
+	void on_tick(void);
+
+	// Time left until the next commit, for background bus traffic to keep out of its way. The timer counts in µs.
+	uint32_t us_until_tick(void) const {
+		return __HAL_TIM_GET_AUTORELOAD(tim_) - __HAL_TIM_GET_COUNTER(tim_);
+	}
+
+	VelocityCommitStats get_stats(void);
+	// Each wheel's ramped velocity minus its measured speed in rad/s, 0 while the loop is open.
+	void get_tracking_errors(float *errors);
+
+private:
+	TMC2209Bus *bus_ = nullptr;
+	TMC2209 *steppers_[WHEEL_COUNT] { };
+	StepGenerator *step_generator_ = nullptr;
+	WheelSpeedsEstimator *estimator_ = nullptr;
+	TIM_HandleTypeDef *tim_ = nullptr;
+	float tick_period_s_ = 0;
+	MotionBackend backend_ = MOTION_BACKEND_DEFAULT;
+
+	int32_t targets_[WHEEL_COUNT] { };
+	RampLimits limits_ { };
+	VelocityRamp ramps_[WHEEL_COUNT];
+	SpeedLoopGains gains_ { };
+	SpeedController speed_loops_[WHEEL_COUNT];
+	int32_t sent_[WHEEL_COUNT] { };  // The drivers start at VACTUAL 0.
+	volatile bool resend_[WHEEL_COUNT] { };
+	volatile bool in_flight_ = false;
+	uint32_t tick_at_ = 0;
+	uint8_t burst_size_ = 0;
+	uint8_t burst_wheels_[WHEEL_COUNT] { };
+	VelocityCommitStats stats_ { };
+
+	// Sends `data` as VACTUAL to `count` wheels, with in_flight_ already set.
+	void send_burst(const uint8_t *wheels, const uint32_t *data, uint8_t count);
+	static void on_burst_complete(void *context, bool ok, uint32_t data);
+	static void on_lost_write(void *context, uint8_t serial_address);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cmath>
+
+// Acceleration and jerk limits for a VelocityRamp, in velocity units per second and per second squared. 0 means no
+// limit: no jerk limit gives a trapezoidal profile, and no acceleration limit a step change.
+struct RampLimits {
+	float acceleration;
+	float jerk;
+};
+
+// Velocity profile stepped at a fixed rate toward a target that may change at any time. With a jerk limit, the
+// acceleration is ramped down ahead of the target so as to land on it without overshooting.
+class VelocityRamp {
+public:
+	float step(float target, const RampLimits &limits, float dt) {
+		if (limits.acceleration <= 0) {
+			velocity_ = target;
+			acceleration_ = 0;
+			return velocity_;
+		}
+
+		const float error = target - velocity_;
+		if (limits.jerk <= 0) {
+			const float max_change = limits.acceleration * dt;
+			const float change = std::fmax(-max_change,
+					std::fmin(error, max_change));
+			velocity_ += change;
+			acceleration_ = change / dt;
+			return velocity_;
+		}
+
+		// Bringing the acceleration down to zero at the jerk limit, one step at a time, covers a^2 / 2j + a * dt / 2:
+		// follow the acceleration that lands exactly on the target, within the acceleration limit.
+		const float half_step = limits.jerk * dt / 2;
+		const float landing = std::sqrt(
+				half_step * half_step + 2 * limits.jerk * std::fabs(error))
+				- half_step;
+		const float wanted = std::copysign(
+				std::fmin(landing, limits.acceleration), error);
+		const float max_change = limits.jerk * dt;
+		acceleration_ += std::fmax(-max_change,
+				std::fmin(wanted - acceleration_, max_change));
+		velocity_ += acceleration_ * dt;
+
+		// Landing on, or stepping across, the target ends the ramp.
+		if ((target - velocity_) * error <= 0) {
+			velocity_ = target;
+			acceleration_ = 0;
+		}
+		return velocity_;
+	}
+
+	// Drops the velocity to 0 on the spot, for an emergency stop.
+	void reset(void) {
+		velocity_ = 0;
+		acceleration_ = 0;
+	}
+
+	float velocity(void) const {
+		return velocity_;
+	}
+
+private:
+	float velocity_ = 0;
+	float acceleration_ = 0;
+};
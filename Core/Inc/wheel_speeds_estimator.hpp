@@ -1,32 +1,67 @@
 #pragma once
 
 #include "peripherals/as5600.h"
-#include "wheel_speed_estimator.hpp"
+#include "peripherals/as5600_bus.hpp"
+#include "wheel_state_estimator.hpp"
+#include "odometry.hpp"
 #include "constants.hpp"
 
-constexpr uint8_t TCA9548A_ADDR = (0x71 << 1);  // Shifted left for HAL (7-bit address)
-
 #pragma pack(push, 1)
 struct WheelInfo {
 	double wheel1_pos, wheel2_pos, wheel3_pos;
 	double wheel1_speed, wheel2_speed, wheel3_speed;
 };
+// Reply to the 't' command.
+struct WheelTicks {
+	int64_t ticks[WHEEL_COUNT]; // Encoder counts since boot or the last reset, signed like the encoders.
+	uint32_t timestamp_us; // When the last sample counted in was read, see timebase.hpp.
+	uint32_t discontinuities; // Since boot, times the counts may have missed turns: sampling stopped, or a long gap.
+};
 #pragma pack(pop)
 
 class WheelSpeedsEstimator {
 public:
-	HAL_StatusTypeDef init(I2C_HandleTypeDef*);
+	// Sets the encoders up, blocking, then hands them over to `bus` for reading in the background.
+	HAL_StatusTypeDef init(I2C_HandleTypeDef*, AS5600Bus *bus);
+	// Starts reading the encoders, the speeds are updated once all of them are in. HAL_BUSY if the last read isn't
+	// done yet, HAL_ERROR if the encoders didn't come up.
 	HAL_StatusTypeDef update(void);
 	WheelInfo get_wheel_info(void);
+	// Wheel speeds in rad/s for feeding back, or false if they are older than max_age_ms or there are none yet.
+	bool get_speeds(float *speeds, uint32_t max_age_ms);
+
+	// Multi-turn encoder counts, unwrapped on every sample. With `reset`, they start over from 0 right after being
+	// read, so that a host summing them up never misses a count. Counts that can't be unwrapped aren't added, and are
+	// flagged in `discontinuities` instead.
+	WheelTicks latch_ticks(bool reset);
+	// Sampling stopped: the next sample can't be unwrapped against the last one.
+	void on_sampling_stopped(void);
+
+	// Pose integrated from the wheel speeds on every sample, and the body twist. With `reset`, the pose starts over
+	// from the origin right after being read.
+	OdometryState get_odometry(bool reset);
+
+	// Each wheel's commanded speed in rad/s, signed like the encoders. Called from the motion tick.
+	void set_commanded_speeds(const float *speeds);
+	// `use_command` feeds the commanded speeds to the filter as a known acceleration.
+	void set_noise(const WheelNoise &noise, bool use_command);
 
 	bool initialized_ = false;
 private:
 	I2C_HandleTypeDef *i2c_ = nullptr;
-	AS5600_TypeDef *as5600_;
-    WheelSpeedEstimator wheel1_, wheel2_, wheel3_;
+	AS5600Bus *bus_ = nullptr;
+	AS5600_TypeDef as5600_[WHEEL_COUNT] { }; // Each encoder keeps its own configuration.
+	WheelStateEstimator wheels_;
+	float commanded_[WHEEL_COUNT] { };
+	bool use_command_ = ESTIMATOR_USE_COMMAND;
+	Odometry odometry_;
+	WheelTicks ticks_ { };
+	uint16_t last_counts_[WHEEL_COUNT] { };
+	uint32_t last_sampled_at_ = 0;
 
-    uint32_t prev_time_ = 0;
+	uint32_t updated_at_ = 0;
+	bool sampled_ = false, has_speeds_ = false;
 
 	HAL_StatusTypeDef set_channel(uint8_t);
-	HAL_StatusTypeDef read_sensors(uint16_t*);
+	static void on_sample(void *context, bool ok, const EncoderSample &sample);
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+#include "constants.hpp"
+
+// Noise parameters for WheelStateEstimator, settable at runtime with the 'n' command.
+struct WheelNoise {
+	float acceleration; // Acceleration the model doesn't account for, as white noise: rad^2/s^3.
+	float measurement; // Encoder angle variance, quantisation and read timing together: rad^2.
+};
+
+// Kalman filter on each wheel's angle and speed, constant velocity model on the wrapped encoder angle. The change in
+// commanded speed since the last update can go in as a known acceleration, so the estimate follows the ramps instead
+// of lagging behind them. The wheels' states are laid out side by side, and all of them are updated in one pass.
+class WheelStateEstimator {
+public:
+	void set_noise(const WheelNoise &noise) {
+		noise_ = noise;
+	}
+	// The next update starts over from its measurements.
+	void reset(void) {
+		started_ = false;
+	}
+
+	// One encoder count per wheel, each read at its own time in µs (see timebase.hpp). `commanded` is each wheel's
+	// commanded speed in rad/s, nullptr to go by the encoders alone.
+	void update(const uint16_t *counts, const uint32_t *timestamps_us,
+			const float *commanded);
+
+	// In [0, 2π).
+	float angle(uint8_t wheel) const {
+		return angle_[wheel];
+	}
+	// rad/s
+	float speed(uint8_t wheel) const {
+		return speed_[wheel];
+	}
+
+private:
+	WheelNoise noise_ { static_cast<float>(ESTIMATOR_ACCELERATION_NOISE),
+			static_cast<float>(ESTIMATOR_MEASUREMENT_NOISE) };
+	bool started_ = false;
+	uint32_t time_[WHEEL_COUNT] { };
+	float commanded_[WHEEL_COUNT] { };
+	float angle_[WHEEL_COUNT] { };
+	float speed_[WHEEL_COUNT] { };
+	// Covariance of angle and speed, symmetric.
+	float p00_[WHEEL_COUNT] { }, p01_[WHEEL_COUNT] { }, p11_[WHEEL_COUNT] { };
+
+	// From its measurement alone, the speed taken to be the commanded one.
+	void start(uint8_t i, uint16_t count, uint32_t time_us, float commanded);
+};
@@ -3,17 +3,17 @@
 #include "commands.hpp"
 
 #include "robot.hpp"
+#include "kinematics.hpp"
 
+#include <cmath>
 #include <cstring> // for memcpy
 
 extern Robot robot;
 extern "C" void Error_Handler(void);
 
-inline double rad_per_s_to_vactual(double u) {
-	double v_rps = u / TAU; // revolutions per second
-	double v_steps_per_second = v_rps * FSC * USC; // steps per second
-	double vactual = v_steps_per_second / 0.715; // VACTUAL register, based on internal oscillator
-	return vactual;
+static void set_wheel_vactuals(const int32_t *vactual) {
+	// Ramped to on the following motion ticks, and only the wheels whose VACTUAL changes go on the bus.
+	robot.velocity_commit_.set_targets(vactual);
 }
 
 void SetServoCommand::execute() {
@@ -23,54 +23,144 @@ void SetServoCommand::execute() {
 
 void ReadWheelInfoCommand::execute() {
 	WheelInfo wheel_info = robot.wheel_speeds_estimator_.get_wheel_info();
-	HAL_UART_Transmit(robot.usb_uart_, reinterpret_cast<uint8_t*>(&wheel_info),
-			sizeof(wheel_info), 100);
+	robot.send_response('a', &wheel_info, sizeof(wheel_info));
 }
 
 void SetWheelSpeedsCommand::execute() {
-	for (uint8_t i = 0; i < STEPPER_CMDS_REPETITION; ++i) {
-		robot.stepper1_.moveAtVelocity(rad_per_s_to_vactual(speeds[0]));
-		robot.stepper2_.moveAtVelocity(rad_per_s_to_vactual(speeds[1]));
-		robot.stepper3_.moveAtVelocity(rad_per_s_to_vactual(speeds[2]));
+	int32_t vactual[WHEEL_COUNT];
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		vactual[i] = Kinematics<float>::rad_per_s_to_vactual(speeds[i]);
 	}
+	set_wheel_vactuals(vactual);
 }
 
 void StopSteppersCommand::execute() {
-	for (uint8_t i = 0; i < STEPPER_CMDS_REPETITION; ++i) {
-		robot.stepper1_.moveAtVelocity(0);
-		robot.stepper2_.moveAtVelocity(0);
-		robot.stepper3_.moveAtVelocity(0);
-	}
+	// Not ramped: the wheels stop now.
+	robot.velocity_commit_.stop_now();
 }
 
 void PongCommand::execute() {
 	const char pong[] = "pong";
-	HAL_UART_Transmit(robot.usb_uart_, reinterpret_cast<const uint8_t*>(pong),
-			sizeof(pong) - 1, 100);
+	robot.send_response('p', pong, sizeof(pong) - 1);
 }
 
 void InverseKinematicsCommand::execute() {
-	double u1 = (-WHEEL_BASE * theta_dot + x_dot) / WHEEL_RADIUS;
-	double u2 = (-WHEEL_BASE * theta_dot - x_dot / 2 - y_dot * SIN_PI_3)
-			/ WHEEL_RADIUS;
-	double u3 = (-WHEEL_BASE * theta_dot - x_dot / 2 + y_dot * SIN_PI_3)
-			/ WHEEL_RADIUS;
-
-	double vactual1 = rad_per_s_to_vactual(u1);
-	double vactual2 = rad_per_s_to_vactual(u2);
-	double vactual3 = rad_per_s_to_vactual(u3);
-
-	for (uint8_t i = 0; i < STEPPER_CMDS_REPETITION; ++i) {
-		robot.stepper1_.moveAtVelocity(static_cast<int32_t>(vactual1));
-		robot.stepper2_.moveAtVelocity(static_cast<int32_t>(vactual2));
-		robot.stepper3_.moveAtVelocity(static_cast<int32_t>(vactual3));
-	}
+	// Kept for hosts still sending doubles: narrow once and do the math in single precision.
+	int32_t vactual[WHEEL_COUNT];
+	Kinematics<float>::inverse(static_cast<float>(x_dot),
+			static_cast<float>(y_dot), static_cast<float>(theta_dot), vactual);
+	set_wheel_vactuals(vactual);
+}
+
+void InverseKinematicsFloatCommand::execute() {
+	int32_t vactual[WHEEL_COUNT];
+	Kinematics<float>::inverse(x_dot, y_dot, theta_dot, vactual);
+	set_wheel_vactuals(vactual);
 }
 
 void LcdPrintCommand::execute() {
 	if (line >= 2) return;
-	robot.lcd_.put_cursor(line, 0);
 	char buf[LCD_WIDTH + 1] {}; // zero-initialized to ensure the string is NUL terminated.
 	std::memcpy(buf, msg, LCD_WIDTH);
+	// The LCD is on the encoders' I2C, and its transfers block: keep encoder reads off the bus meanwhile.
+	robot.encoder_bus_.lock();
+	robot.lcd_.put_cursor(line, 0);
 	robot.lcd_.send_string(buf);
+	robot.encoder_bus_.unlock();
+}
+
+void SubscribeTelemetryCommand::execute() {
+	robot.start_telemetry(rate_hz);
+}
+
+void UnsubscribeTelemetryCommand::execute() {
+	robot.stop_telemetry();
+}
+
+void ReadVelocityCommitStatsCommand::execute() {
+	const VelocityCommitStats stats = robot.velocity_commit_.get_stats();
+	robot.send_response('v', &stats, sizeof(stats));
+}
+
+void ReadStepperLostWritesCommand::execute() {
+	const uint32_t lost_writes[WHEEL_COUNT] = {
+			robot.stepper1_.getLostWriteCount(),
+			robot.stepper2_.getLostWriteCount(),
+			robot.stepper3_.getLostWriteCount() };
+	robot.send_response('e', lost_writes, sizeof(lost_writes));
+}
+
+void ReadStepperStatusCommand::execute() {
+	const StepperStatusReport report =
+			robot.stepper_status_poller_.get_report();
+	robot.send_response('d', &report, sizeof(report));
+}
+
+void SetRampLimitsCommand::execute() {
+	// Straight off the wire: NaN or infinite limits would never land on a target.
+	if (!(acceleration > 0) || !(jerk > 0) || !std::isfinite(acceleration)
+			|| !std::isfinite(jerk))
+		return;
+	robot.velocity_commit_.set_ramp_limits( {
+			acceleration * static_cast<float>(RAD_PER_S_TO_VACTUAL),
+			jerk * static_cast<float>(RAD_PER_S_TO_VACTUAL) });
+}
+
+void SetMotionBackendCommand::execute() {
+	if (backend > static_cast<uint8_t>(MotionBackend::STEP_DIR))
+		return;
+	robot.velocity_commit_.set_backend(static_cast<MotionBackend>(backend));
+}
+
+void ReadStepCountsCommand::execute() {
+	int32_t steps[WHEEL_COUNT];
+	robot.step_generator_.get_positions(steps);
+	robot.send_response('c', steps, sizeof(steps));
+}
+
+void ReadBootStatsCommand::execute() {
+	robot.send_response('b', &robot.boot_stats_, sizeof(robot.boot_stats_));
+}
+
+void SetSpeedLoopGainsCommand::execute() {
+	// Straight off the wire: NaN would stick in the integral, and negative gains or max correction turn the loop and
+	// its anti-windup clamp inside out.
+	if (!(kp >= 0) || !(ki >= 0) || !(max_correction >= 0) || !std::isfinite(kp)
+			|| !std::isfinite(ki) || !std::isfinite(max_correction))
+		return;
+	// The loops run in VACTUAL units, the gains are ratios and carry over as they are.
+	robot.velocity_commit_.set_speed_loop_gains( { kp, ki, max_correction
+			* static_cast<float>(RAD_PER_S_TO_VACTUAL) });
+}
+
+void SetEncoderSampleRateCommand::execute() {
+	if (rate_hz == 0) {
+		robot.encoder_sampler_.stop();
+	} else {
+		robot.encoder_sampler_.start(rate_hz);
+	}
+}
+
+void ReadEncoderSamplingStatsCommand::execute() {
+	const EncoderSamplingStats stats = robot.encoder_sampler_.get_stats();
+	robot.send_response('j', &stats, sizeof(stats));
+}
+
+void SetEstimatorNoiseCommand::execute() {
+	if (!(acceleration > 0) || !(measurement > 0))
+		return;
+	robot.wheel_speeds_estimator_.set_noise( { acceleration, measurement },
+			use_command != 0);
+}
+
+void LatchWheelTicksCommand::execute() {
+	const WheelTicks ticks = robot.wheel_speeds_estimator_.latch_ticks(
+			reset != 0);
+	robot.send_response('t', &ticks, sizeof(ticks));
+}
+
+void ReadOdometryCommand::execute() {
+	const OdometryState state = robot.wheel_speeds_estimator_.get_odometry(
+			reset != 0);
+	robot.send_response('o', &state, sizeof(state));
 }
@@ -0,0 +1,79 @@
+#include "encoder_sampler.hpp"
+
+#include "critical_section.hpp"
+#include "cycle_counter.hpp"
+
+void EncoderSampler::init(WheelSpeedsEstimator *estimator, AS5600Bus *bus,
+		TIM_HandleTypeDef *tim) {
+	estimator_ = estimator;
+	bus_ = bus;
+	tim_ = tim;
+}
+
+HAL_StatusTypeDef EncoderSampler::start(uint16_t rate_hz) {
+	if (rate_hz < ENCODER_SAMPLE_MIN_RATE_HZ)
+		rate_hz = ENCODER_SAMPLE_MIN_RATE_HZ;
+	if (rate_hz > ENCODER_SAMPLE_MAX_RATE_HZ)
+		rate_hz = ENCODER_SAMPLE_MAX_RATE_HZ;
+
+	HAL_TIM_Base_Stop_IT(tim_);
+	{
+		CriticalSection cs;
+		rate_hz_ = rate_hz;
+		samples_ = overruns_ = ticks_ = 0;
+		failed_at_start_ = bus_->failed();
+		timeouts_at_start_ = bus_->timeouts();
+		min_period_us_ = max_period_us_ = 0;
+		total_period_us_ = 0;
+	}
+	// The timer counts at 1 MHz.
+	__HAL_TIM_SET_AUTORELOAD(tim_, 1000000 / rate_hz - 1);
+	__HAL_TIM_SET_COUNTER(tim_, 0);
+	return HAL_TIM_Base_Start_IT(tim_);
+}
+
+HAL_StatusTypeDef EncoderSampler::stop(void) {
+	rate_hz_ = 0;
+	const HAL_StatusTypeDef status = HAL_TIM_Base_Stop_IT(tim_);
+	estimator_->on_sampling_stopped();
+	return status;
+}
+
+void EncoderSampler::on_tick(void) {
+	const uint32_t now = cycle_counter();
+	if (ticks_ > 0) {
+		const uint32_t period = cycles_to_us(now - last_tick_at_);
+		if (ticks_ == 1 || period < min_period_us_) {
+			min_period_us_ = period;
+		}
+		if (period > max_period_us_) {
+			max_period_us_ = period;
+		}
+		total_period_us_ += period;
+	}
+	last_tick_at_ = now;
+	++ticks_;
+
+	switch (estimator_->update()) {
+	case HAL_OK:
+		++samples_;
+		break;
+	case HAL_BUSY:
+		++overruns_;
+		break;
+	default:
+		break;
+	}
+}
+
+EncoderSamplingStats EncoderSampler::get_stats(void) {
+	CriticalSection cs;
+	const uint32_t periods = ticks_ > 0 ? ticks_ - 1 : 0;
+	return {
+		rate_hz_, samples_, overruns_,
+		bus_->failed() - failed_at_start_,
+		bus_->timeouts() - timeouts_at_start_,
+		min_period_us_, max_period_us_,
+		periods > 0 ? static_cast<uint32_t>(total_period_us_ / periods) : 0
+	};
+}
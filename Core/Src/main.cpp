@@ -22,6 +22,7 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "robot.hpp"
+#include "timebase.hpp"
 #include "commands.hpp"
 #include "constants.hpp"
 /* USER CODE END Includes */
@@ -51,6 +52,17 @@ TIM_HandleTypeDef htim1;
 UART_HandleTypeDef huart1;
 
 /* USER CODE BEGIN PV */
+DMA_NodeTypeDef Node_GPDMA1_Channel0;
+DMA_QListTypeDef List_GPDMA1_Channel0;
+DMA_HandleTypeDef handle_GPDMA1_Channel0;
+DMA_HandleTypeDef handle_GPDMA1_Channel1;
+DMA_HandleTypeDef handle_GPDMA1_Channel2;
+DMA_HandleTypeDef handle_GPDMA1_Channel3;
+TIM_HandleTypeDef htim6;
+TIM_HandleTypeDef htim7;
+TIM_HandleTypeDef htim2;
+TIM_HandleTypeDef htim3;
+
 Robot robot;
 
 volatile uint8_t error_flashes = 0;
@@ -64,6 +76,12 @@ static void MX_USART1_UART_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_TIM1_Init(void);
 /* USER CODE BEGIN PFP */
+static void MX_USART3_DMA_Init(void);
+static void MX_USART1_DMA_Init(void);
+static void MX_TIM6_Init(void);
+static void MX_TIM7_Init(void);
+static void MX_TIM2_Init(void);
+static void MX_TIM3_Init(void);
 
 /* USER CODE END PFP */
 
@@ -128,8 +146,16 @@ int main(void) {
 	// XXX: this is a hack due to the fact that the ioc file does not let us configure these things directly on USART3, so we do it ourselves in code.
 	HAL_NVIC_SetPriority(USART3_IRQn, 0, 0);
 	HAL_NVIC_EnableIRQ(USART3_IRQn);
+	MX_USART3_DMA_Init();
+	MX_USART1_DMA_Init();
+	MX_TIM6_Init();
+	MX_TIM7_Init();
+	MX_TIM2_Init();
+	MX_TIM3_Init();
+	timebase_init();
 
-	robot.init(&huart1, &hcom_uart[COM1], &hi2c1);
+	robot.init(&huart1, &hcom_uart[COM1], &hi2c1, &htim6, &htim7, &htim2,
+			&htim3);
 
 	// Start off with claw open and elevator at resting position.
 	TIM1->CCR1 = 10000 / 50 * 11;
@@ -141,6 +167,8 @@ int main(void) {
 		/* USER CODE END WHILE */
 
 		/* USER CODE BEGIN 3 */
+		robot.service_steppers();
+		robot.usb_tx_queue_.poll();
 		robot.recv_command();
 	}
 	/* USER CODE END 3 */
@@ -232,7 +260,12 @@ static void MX_I2C1_Init(void) {
 		Error_Handler();
 	}
 	/* USER CODE BEGIN I2C1_Init 2 */
-
+	// The wheel encoders are read in the background, but the ioc file only has I2C1 in polling mode. Same priority
+	// as the motion tick, which feeds their speeds back.
+	HAL_NVIC_SetPriority(I2C1_EV_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+	HAL_NVIC_SetPriority(I2C1_ER_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
 	/* USER CODE END I2C1_Init 2 */
 
 }
@@ -434,11 +467,375 @@ static void MX_GPIO_Init(void) {
 }
 
 /* USER CODE BEGIN 4 */
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+/**
+ * @brief USART3 RX & TX DMA Initialization Function
+ * @note RX uses channel 0 and TX channel 1. GPDMA only supports circular transfers through a circular linked-list
+ *       queue, so for RX we build a single node that loops on itself. Like the USART3 NVIC setup, the ioc file won't
+ *       generate this for the BSP COM port.
+ * @param None
+ * @retval None
+ */
+static void MX_USART3_DMA_Init(void) {
+	DMA_NodeConfTypeDef NodeConfig = { 0 };
+
+	__HAL_RCC_GPDMA1_CLK_ENABLE();
+
+	NodeConfig.NodeType = DMA_GPDMA_LINEAR_NODE;
+	NodeConfig.Init.Request = GPDMA1_REQUEST_USART3_RX;
+	NodeConfig.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+	NodeConfig.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	NodeConfig.Init.SrcInc = DMA_SINC_FIXED;
+	NodeConfig.Init.DestInc = DMA_DINC_INCREMENTED;
+	NodeConfig.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
+	NodeConfig.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+	NodeConfig.Init.SrcBurstLength = 1;
+	NodeConfig.Init.DestBurstLength = 1;
+	NodeConfig.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0
+			| DMA_DEST_ALLOCATED_PORT0;
+	NodeConfig.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+	NodeConfig.Init.Mode = DMA_NORMAL;
+	NodeConfig.TriggerConfig.TriggerPolarity = DMA_TRIG_POLARITY_MASKED;
+	NodeConfig.DataHandlingConfig.DataExchange = DMA_EXCHANGE_NONE;
+	NodeConfig.DataHandlingConfig.DataAlignment =
+			DMA_DATA_RIGHTALIGN_ZEROPADDED;
+	if (HAL_DMAEx_List_BuildNode(&NodeConfig, &Node_GPDMA1_Channel0)
+			!= HAL_OK) {
+		Error_Handler();
+	}
+	if (HAL_DMAEx_List_InsertNode(&List_GPDMA1_Channel0, NULL,
+			&Node_GPDMA1_Channel0) != HAL_OK) {
+		Error_Handler();
+	}
+	if (HAL_DMAEx_List_SetCircularMode(&List_GPDMA1_Channel0) != HAL_OK) {
+		Error_Handler();
+	}
+
+	handle_GPDMA1_Channel0.Instance = GPDMA1_Channel0;
+	handle_GPDMA1_Channel0.InitLinkedList.Priority = DMA_HIGH_PRIORITY;
+	handle_GPDMA1_Channel0.InitLinkedList.LinkStepMode = DMA_LSM_FULL_EXECUTION;
+	handle_GPDMA1_Channel0.InitLinkedList.LinkAllocatedPort =
+			DMA_LINK_ALLOCATED_PORT0;
+	handle_GPDMA1_Channel0.InitLinkedList.TransferEventMode =
+			DMA_TCEM_BLOCK_TRANSFER;
+	handle_GPDMA1_Channel0.InitLinkedList.LinkedListMode =
+			DMA_LINKEDLIST_CIRCULAR;
+	if (HAL_DMAEx_List_Init(&handle_GPDMA1_Channel0) != HAL_OK) {
+		Error_Handler();
+	}
+	if (HAL_DMAEx_List_LinkQ(&handle_GPDMA1_Channel0, &List_GPDMA1_Channel0)
+			!= HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hcom_uart[COM1], hdmarx, handle_GPDMA1_Channel0);
+	if (HAL_DMA_ConfigChannelAttributes(&handle_GPDMA1_Channel0,
+			DMA_CHANNEL_NPRIV) != HAL_OK) {
+		Error_Handler();
+	}
+
+	HAL_NVIC_SetPriority(GPDMA1_Channel0_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(GPDMA1_Channel0_IRQn);
+
+	handle_GPDMA1_Channel1.Instance = GPDMA1_Channel1;
+	handle_GPDMA1_Channel1.Init.Request = GPDMA1_REQUEST_USART3_TX;
+	handle_GPDMA1_Channel1.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+	handle_GPDMA1_Channel1.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	handle_GPDMA1_Channel1.Init.SrcInc = DMA_SINC_INCREMENTED;
+	handle_GPDMA1_Channel1.Init.DestInc = DMA_DINC_FIXED;
+	handle_GPDMA1_Channel1.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
+	handle_GPDMA1_Channel1.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+	handle_GPDMA1_Channel1.Init.Priority = DMA_LOW_PRIORITY_HIGH_WEIGHT;
+	handle_GPDMA1_Channel1.Init.SrcBurstLength = 1;
+	handle_GPDMA1_Channel1.Init.DestBurstLength = 1;
+	handle_GPDMA1_Channel1.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0
+			| DMA_DEST_ALLOCATED_PORT0;
+	handle_GPDMA1_Channel1.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+	handle_GPDMA1_Channel1.Init.Mode = DMA_NORMAL;
+	if (HAL_DMA_Init(&handle_GPDMA1_Channel1) != HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hcom_uart[COM1], hdmatx, handle_GPDMA1_Channel1);
+	if (HAL_DMA_ConfigChannelAttributes(&handle_GPDMA1_Channel1,
+			DMA_CHANNEL_NPRIV) != HAL_OK) {
+		Error_Handler();
+	}
+
+	HAL_NVIC_SetPriority(GPDMA1_Channel1_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(GPDMA1_Channel1_IRQn);
+}
+
+/**
+ * @brief USART1 RX & TX DMA Initialization Function
+ * @note RX uses channel 2 and TX channel 3, both in normal mode: the TMC2209 bus runs one DMA transfer each way per
+ *       datagram. The ioc file only has USART1 in polling mode, so the NVIC is set up here too.
+ * @param None
+ * @retval None
+ */
+static void MX_USART1_DMA_Init(void) {
+	__HAL_RCC_GPDMA1_CLK_ENABLE();
+
+	handle_GPDMA1_Channel2.Instance = GPDMA1_Channel2;
+	handle_GPDMA1_Channel2.Init.Request = GPDMA1_REQUEST_USART1_RX;
+	handle_GPDMA1_Channel2.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+	handle_GPDMA1_Channel2.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	handle_GPDMA1_Channel2.Init.SrcInc = DMA_SINC_FIXED;
+	handle_GPDMA1_Channel2.Init.DestInc = DMA_DINC_INCREMENTED;
+	handle_GPDMA1_Channel2.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
+	handle_GPDMA1_Channel2.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+	handle_GPDMA1_Channel2.Init.Priority = DMA_LOW_PRIORITY_HIGH_WEIGHT;
+	handle_GPDMA1_Channel2.Init.SrcBurstLength = 1;
+	handle_GPDMA1_Channel2.Init.DestBurstLength = 1;
+	handle_GPDMA1_Channel2.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0
+			| DMA_DEST_ALLOCATED_PORT0;
+	handle_GPDMA1_Channel2.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+	handle_GPDMA1_Channel2.Init.Mode = DMA_NORMAL;
+	if (HAL_DMA_Init(&handle_GPDMA1_Channel2) != HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&huart1, hdmarx, handle_GPDMA1_Channel2);
+	if (HAL_DMA_ConfigChannelAttributes(&handle_GPDMA1_Channel2,
+			DMA_CHANNEL_NPRIV) != HAL_OK) {
+		Error_Handler();
+	}
+
+	handle_GPDMA1_Channel3.Instance = GPDMA1_Channel3;
+	handle_GPDMA1_Channel3.Init.Request = GPDMA1_REQUEST_USART1_TX;
+	handle_GPDMA1_Channel3.Init.BlkHWRequest = DMA_BREQ_SINGLE_BURST;
+	handle_GPDMA1_Channel3.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	handle_GPDMA1_Channel3.Init.SrcInc = DMA_SINC_INCREMENTED;
+	handle_GPDMA1_Channel3.Init.DestInc = DMA_DINC_FIXED;
+	handle_GPDMA1_Channel3.Init.SrcDataWidth = DMA_SRC_DATAWIDTH_BYTE;
+	handle_GPDMA1_Channel3.Init.DestDataWidth = DMA_DEST_DATAWIDTH_BYTE;
+	handle_GPDMA1_Channel3.Init.Priority = DMA_LOW_PRIORITY_HIGH_WEIGHT;
+	handle_GPDMA1_Channel3.Init.SrcBurstLength = 1;
+	handle_GPDMA1_Channel3.Init.DestBurstLength = 1;
+	handle_GPDMA1_Channel3.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0
+			| DMA_DEST_ALLOCATED_PORT0;
+	handle_GPDMA1_Channel3.Init.TransferEventMode = DMA_TCEM_BLOCK_TRANSFER;
+	handle_GPDMA1_Channel3.Init.Mode = DMA_NORMAL;
+	if (HAL_DMA_Init(&handle_GPDMA1_Channel3) != HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&huart1, hdmatx, handle_GPDMA1_Channel3);
+	if (HAL_DMA_ConfigChannelAttributes(&handle_GPDMA1_Channel3,
+			DMA_CHANNEL_NPRIV) != HAL_OK) {
+		Error_Handler();
+	}
+
+	// All three at the same priority, so the bus' completion handlers never preempt each other.
+	HAL_NVIC_SetPriority(GPDMA1_Channel2_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(GPDMA1_Channel2_IRQn);
+	HAL_NVIC_SetPriority(GPDMA1_Channel3_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(GPDMA1_Channel3_IRQn);
+	HAL_NVIC_SetPriority(USART1_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+}
+
+/**
+ * @brief TIM6 Initialization Function
+ * @note Paces the wheel telemetry stream: counts at 100 kHz, and the period is set when the host subscribes. The
+ *       interrupt priority is below the USART3 and DMA ones so that streaming never holds up the host link.
+ * @param None
+ * @retval None
+ */
+static void MX_TIM6_Init(void) {
+	__HAL_RCC_TIM6_CLK_ENABLE();
+
+	htim6.Instance = TIM6;
+	htim6.Init.Prescaler = 640 - 1;
+	htim6.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim6.Init.Period = 100000 / TELEMETRY_MIN_RATE_HZ - 1;
+	htim6.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	if (HAL_TIM_Base_Init(&htim6) != HAL_OK) {
+		Error_Handler();
+	}
+
+	HAL_NVIC_SetPriority(TIM6_IRQn, 2, 0);
+	HAL_NVIC_EnableIRQ(TIM6_IRQn);
+}
+
+/**
+ * @brief TIM7 Initialization Function
+ * @note Motion tick: counts at 1 MHz, and wheel velocity changes are committed to the drivers on each update event.
+ *       Same interrupt priority as the TMC2209 bus.
+ * @param None
+ * @retval None
+ */
+static void MX_TIM7_Init(void) {
+	__HAL_RCC_TIM7_CLK_ENABLE();
+
+	htim7.Instance = TIM7;
+	htim7.Init.Prescaler = 64 - 1;
+	htim7.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim7.Init.Period = 1000000 / VELOCITY_COMMIT_RATE_HZ - 1;
+	htim7.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+	if (HAL_TIM_Base_Init(&htim7) != HAL_OK) {
+		Error_Handler();
+	}
+
+	HAL_NVIC_SetPriority(TIM7_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(TIM7_IRQn);
+}
+
+/**
+ * @brief TIM2 Initialization Function
+ * @note STEP pulse generation: free running at the core clock over the full 32 bits, channels 1 to 3 in output
+ *       compare toggle mode, one per wheel. The pins toggle in hardware, the interrupt only sets the next compare
+ *       point half a period ahead (500 µs or more, see STEP_MAX_RATE_HZ): it can wait behind the host link and the
+ *       motion tick, and sits at the telemetry timer's priority, below both.
+ * @param None
+ * @retval None
+ */
+static void MX_TIM2_Init(void) {
+	GPIO_InitTypeDef GPIO_InitStruct = { 0 };
+	TIM_OC_InitTypeDef sConfigOC = { 0 };
+
+	__HAL_RCC_TIM2_CLK_ENABLE();
+	__HAL_RCC_GPIOA_CLK_ENABLE();
+	__HAL_RCC_GPIOB_CLK_ENABLE();
+	__HAL_RCC_GPIOC_CLK_ENABLE();
+
+	htim2.Instance = TIM2;
+	htim2.Init.Prescaler = 0;
+	htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim2.Init.Period = 0xFFFFFFFF;
+	htim2.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim2.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	if (HAL_TIM_OC_Init(&htim2) != HAL_OK) {
+		Error_Handler();
+	}
+
+	// Forced inactive until a wheel starts stepping, see StepGenerator.
+	sConfigOC.OCMode = TIM_OCMODE_FORCED_INACTIVE;
+	sConfigOC.Pulse = 0;
+	sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+	sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+	if (HAL_TIM_OC_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_1) != HAL_OK
+			|| HAL_TIM_OC_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_2)
+					!= HAL_OK
+			|| HAL_TIM_OC_ConfigChannel(&htim2, &sConfigOC, TIM_CHANNEL_3)
+					!= HAL_OK) {
+		Error_Handler();
+	}
+
+	/**TIM2 GPIO Configuration
+	 PA0     ------> TIM2_CH1
+	 PB3     ------> TIM2_CH2 (SWO, see main.h)
+	 PB10     ------> TIM2_CH3
+	 */
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	GPIO_InitStruct.Alternate = GPIO_AF1_TIM2;
+	GPIO_InitStruct.Pin = STEP1_Pin;
+	HAL_GPIO_Init(STEP1_GPIO_Port, &GPIO_InitStruct);
+	GPIO_InitStruct.Pin = STEP2_Pin | STEP3_Pin;
+	HAL_GPIO_Init(STEP2_GPIO_Port, &GPIO_InitStruct);
+
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Alternate = 0;
+	GPIO_InitStruct.Pin = DIR1_Pin | DIR2_Pin | DIR3_Pin;
+	HAL_GPIO_Init(DIR1_GPIO_Port, &GPIO_InitStruct);
+
+	HAL_NVIC_SetPriority(TIM2_IRQn, 2, 0);
+	HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+/**
+ * @brief TIM3 Initialization Function
+ * @note Encoder sampling: counts at 1 MHz, and an encoder acquisition starts on each update event. Same interrupt
+ *       priority as the I2C, so a completion never lands halfway through a start.
+ * @param None
+ * @retval None
+ */
+static void MX_TIM3_Init(void) {
+	__HAL_RCC_TIM3_CLK_ENABLE();
+
+	htim3.Instance = TIM3;
+	htim3.Init.Prescaler = 64 - 1;
+	htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
+	htim3.Init.Period = 1000000 / ENCODER_SAMPLE_RATE_HZ - 1;
+	htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+	if (HAL_TIM_Base_Init(&htim3) != HAL_OK) {
+		Error_Handler();
+	}
+
+	HAL_NVIC_SetPriority(TIM3_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(TIM3_IRQn);
+}
+
+// Called on DMA half/full transfer and on UART idle line. In circular mode `size` is the DMA write index into the
+// ring buffer's storage, so publishing it is all the producer has to do.
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t size) {
 	if (huart != robot.usb_uart_)
 		return;
-	robot.usb_rx_buf_.push(robot.usb_rx_temp_);
-	HAL_UART_Receive_IT(huart, &robot.usb_rx_temp_, 1);
+	robot.usb_rx_buf_.set_head(size);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+	if (huart == robot.usb_uart_) {
+		robot.usb_tx_queue_.on_tx_complete();
+	} else if (huart == robot.tmc_uart_) {
+		robot.tmc_bus_.on_tx_complete();
+	}
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+	if (huart == robot.tmc_uart_) {
+		robot.tmc_bus_.on_rx_complete();
+	}
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+	if (huart == robot.tmc_uart_) {
+		robot.tmc_bus_.on_error();
+	}
+}
+
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim) {
+	if (htim != robot.step_tim_)
+		return;
+	switch (htim->Channel) {
+	case HAL_TIM_ACTIVE_CHANNEL_1:
+		robot.step_generator_.on_compare(0);
+		break;
+	case HAL_TIM_ACTIVE_CHANNEL_2:
+		robot.step_generator_.on_compare(1);
+		break;
+	case HAL_TIM_ACTIVE_CHANNEL_3:
+		robot.step_generator_.on_compare(2);
+		break;
+	default:
+		break;
+	}
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
+	if (htim == robot.telemetry_tim_) {
+		robot.send_telemetry();
+	} else if (htim == robot.motion_tim_) {
+		robot.velocity_commit_.on_tick();
+	} else if (htim == robot.encoder_tim_) {
+		robot.encoder_sampler_.on_tick();
+	}
+}
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+	if (hi2c == robot.i2c_) {
+		robot.encoder_bus_.on_tx_complete();
+	}
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+	if (hi2c == robot.i2c_) {
+		robot.encoder_bus_.on_rx_complete();
+	}
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+	if (hi2c == robot.i2c_) {
+		robot.encoder_bus_.on_error();
+	}
 }
 
 void busy_wait(uint32_t ms) {
@@ -0,0 +1,48 @@
+#include "odometry.hpp"
+
+#include <cmath>
+
+#include "kinematics.hpp"
+#include "timebase.hpp"
+
+// Longer than this between samples and the last twist says little about what happened in between: the pose holds.
+constexpr float MAX_INTEGRATION_STEP_S = 0.1f;
+
+template<uint8_t ROW>
+static inline float body_rate(const float *wheel_speeds) {
+	return static_cast<float>(FK_MATRIX[ROW][0]) * wheel_speeds[0]
+			+ static_cast<float>(FK_MATRIX[ROW][1]) * wheel_speeds[1]
+			+ static_cast<float>(FK_MATRIX[ROW][2]) * wheel_speeds[2];
+}
+
+void Odometry::update(const float *wheel_speeds, uint32_t time_us) {
+	const float x_dot = body_rate<0>(wheel_speeds);
+	const float y_dot = body_rate<1>(wheel_speeds);
+	const float psi_dot = body_rate<2>(wheel_speeds);
+
+	const float dt = us_between(state_.timestamp_us, time_us) * 1e-6f;
+	if (started_ && dt > 0 && dt <= MAX_INTEGRATION_STEP_S) {
+		const float vx = 0.5f * (state_.x_dot + x_dot);
+		const float vy = 0.5f * (state_.y_dot + y_dot);
+		const float w = 0.5f * (state_.psi_dot + psi_dot);
+		const float heading = state_.psi + 0.5f * w * dt;
+		const float c = std::cos(heading);
+		const float s = std::sin(heading);
+		state_.x += (vx * c - vy * s) * dt;
+		state_.y += (vx * s + vy * c) * dt;
+		state_.psi = std::remainder(state_.psi + w * dt,
+				static_cast<float>(TAU));
+	}
+
+	state_.x_dot = x_dot;
+	state_.y_dot = y_dot;
+	state_.psi_dot = psi_dot;
+	state_.timestamp_us = time_us;
+	started_ = true;
+}
+
+void Odometry::reset(void) {
+	state_.x = 0;
+	state_.y = 0;
+	state_.psi = 0;
+}
@@ -8,10 +8,13 @@
 
 #include "stm32h5xx_hal.h"
 #include "stm32h5xx_nucleo.h"
+#include "critical_section.hpp"
 
 #include <type_traits>
 #include <limits>
 
+using namespace tmc2209_reg;
+
 template<typename T, typename U = long>
 T map(T x, T in_min, T in_max, T out_min, T out_max) {
 	static_assert(std::is_arithmetic<T>::value, "T must be an arithmetic type");
@@ -34,17 +37,121 @@ T map(T x, T in_min, T in_max, T out_min, T out_max) {
 }
 
 TMC2209::TMC2209() {
-	huart_ = nullptr;
+	bus_ = nullptr;
 	serial_baud_rate_ = 115200;
 	serial_address_ = SERIAL_ADDRESS_0;
 	hardware_enable_port_ = nullptr;
 	hardware_enable_pin_ = 0;
 	cool_step_enabled_ = false;
+
+	const uint8_t shadow_addresses[SHADOW_REGISTER_COUNT] = { ADDRESS_GCONF,
+			ADDRESS_REPLYDELAY, ADDRESS_IHOLD_IRUN, ADDRESS_TPOWERDOWN,
+			ADDRESS_TPWMTHRS, ADDRESS_TCOOLTHRS, ADDRESS_SGTHRS,
+			ADDRESS_COOLCONF, ADDRESS_PWMCONF, ADDRESS_CHOPCONF,
+			ADDRESS_VACTUAL };
+	for (uint8_t i = 0; i < SHADOW_REGISTER_COUNT; ++i) {
+		shadow_registers_[i].address = shadow_addresses[i];
+		shadow_registers_[i].valid = false; // Not written yet, leave it be.
+		shadow_registers_[i].dirty = false;
+		shadow_registers_[i].value = 0;
+	}
+
+	unverified_registers_ = 0;
+	verifying_registers_ = 0;
+	interface_counter_valid_ = false;
+	interface_counter_ = 0;
+	writes_at_interface_counter_ = 0;
+	lost_writes_ = 0;
+	velocity_lost_write_callback_ = nullptr;
+	velocity_lost_write_context_ = nullptr;
+	verify_pending_ = false;
+	verify_done_ = false;
+	verify_ok_ = false;
+	verify_interface_counter_ = 0;
+	verify_writes_ = 0;
+}
+
+void TMC2209::setup(TMC2209Bus *bus, long serial_baud_rate,
+		SerialAddress serial_address) {
+	initialize(bus, serial_baud_rate, serial_address);
 }
 
-void TMC2209::setup(UART_HandleTypeDef *new_huart, long serial_baud_rate,
+void TMC2209::attach(TMC2209Bus *bus, long serial_baud_rate,
 		SerialAddress serial_address) {
-	initialize(new_huart, serial_baud_rate, serial_address);
+	bus_ = bus;
+	serial_baud_rate_ = serial_baud_rate;
+	serial_address_ = serial_address;
+
+	// IFCNT before anything is written, for the first check to compare with.
+	startWriteVerification();
+}
+
+bool TMC2209::writeRegisterImage(TMC2209 *const *drivers, uint8_t count,
+		const RegisterImage &image, TMC2209Bus::Callback on_sent,
+		void *context) {
+	if (count == 0 || count > TMC2209Bus::MAX_BURST)
+		return false;
+
+	uint8_t addresses[TMC2209Bus::MAX_BURST];
+	for (uint8_t i = 0; i < count; ++i) {
+		addresses[i] = drivers[i]->serial_address_;
+	}
+
+	bool queued = true;
+	for (size_t r = 0; r < image.size(); ++r) {
+		uint32_t data[TMC2209Bus::MAX_BURST];
+		for (uint8_t i = 0; i < count; ++i) {
+			data[i] = image[r].value;
+		}
+		queued = drivers[0]->bus_->write_burst(addresses, image[r].address,
+				data, count, on_sent, context) && queued;
+	}
+
+	for (uint8_t i = 0; i < count; ++i) {
+		drivers[i]->adoptRegisterImage(image);
+	}
+	return queued;
+}
+
+bool TMC2209::verifyRegisterImage(const RegisterImage &image) {
+	if (__get_IPSR() != 0)
+		return false;
+
+	struct Check {
+		volatile uint8_t *pending;
+		volatile bool *ok;
+		uint32_t expected;
+	};
+	volatile uint8_t pending = 0;
+	volatile bool ok = true;
+	Check checks[REGISTER_IMAGE_SIZE];
+	auto on_reply = [](void *context, bool reply_ok, uint32_t data) {
+		auto *check = static_cast<Check*>(context);
+		if (!reply_ok || data != check->expected) {
+			*check->ok = false;
+		}
+		--*check->pending;
+	};
+
+	// All queued together, so the reads go out back to back.
+	for (size_t r = 0; r < image.size(); ++r) {
+		if (!isReadable(image[r].address))
+			continue;
+		checks[r] = { &pending, &ok, image[r].value };
+		{
+			CriticalSection cs;
+			++pending;
+		}
+		if (!readAsync(image[r].address, on_reply, &checks[r])) {
+			CriticalSection cs;
+			--pending;
+			ok = false;
+		}
+	}
+	while (pending != 0) {
+		__WFI();
+	}
+	return ok;
 }
 
 // unidirectional methods
@@ -60,7 +167,7 @@ void TMC2209::enable() {
 		HAL_GPIO_WritePin(hardware_enable_port_, hardware_enable_pin_,
 				GPIO_PIN_SET);
 	}
-	chopper_config_.toff = toff_;
+	CHOPCONF::toff::set(chopper_config_, toff_);
 	writeStoredChopperConfig();
 }
 
@@ -69,7 +176,7 @@ void TMC2209::disable() {
 		HAL_GPIO_WritePin(hardware_enable_port_, hardware_enable_pin_,
 				GPIO_PIN_RESET);
 	}
-	chopper_config_.toff = TOFF_DISABLE;
+	CHOPCONF::toff::set(chopper_config_, TOFF_DISABLE);
 	writeStoredChopperConfig();
 }
 
@@ -88,40 +195,40 @@ void TMC2209::setMicrostepsPerStep(uint16_t microsteps_per_step) {
 void TMC2209::setMicrostepsPerStepPowerOfTwo(uint8_t exponent) {
 	switch (exponent) {
 	case 0: {
-		chopper_config_.mres = MRES_001;
+		CHOPCONF::mres::set(chopper_config_, MRES_001);
 		break;
 	}
 	case 1: {
-		chopper_config_.mres = MRES_002;
+		CHOPCONF::mres::set(chopper_config_, MRES_002);
 		break;
 	}
 	case 2: {
-		chopper_config_.mres = MRES_004;
+		CHOPCONF::mres::set(chopper_config_, MRES_004);
 		break;
 	}
 	case 3: {
-		chopper_config_.mres = MRES_008;
+		CHOPCONF::mres::set(chopper_config_, MRES_008);
 		break;
 	}
 	case 4: {
-		chopper_config_.mres = MRES_016;
+		CHOPCONF::mres::set(chopper_config_, MRES_016);
 		break;
 	}
 	case 5: {
-		chopper_config_.mres = MRES_032;
+		CHOPCONF::mres::set(chopper_config_, MRES_032);
 		break;
 	}
 	case 6: {
-		chopper_config_.mres = MRES_064;
+		CHOPCONF::mres::set(chopper_config_, MRES_064);
 		break;
 	}
 	case 7: {
-		chopper_config_.mres = MRES_128;
+		CHOPCONF::mres::set(chopper_config_, MRES_128);
 		break;
 	}
 	case 8:
 	default: {
-		chopper_config_.mres = MRES_256;
+		CHOPCONF::mres::set(chopper_config_, MRES_256);
 		break;
 	}
 	}
@@ -130,21 +237,21 @@ void TMC2209::setMicrostepsPerStepPowerOfTwo(uint8_t exponent) {
 
 void TMC2209::setRunCurrent(uint8_t percent) {
 	uint8_t run_current = percentToCurrentSetting(percent);
-	driver_current_.irun = run_current;
+	IHOLD_IRUN::irun::set(driver_current_, run_current);
 	writeStoredDriverCurrent();
 }
 
 void TMC2209::setHoldCurrent(uint8_t percent) {
 	uint8_t hold_current = percentToCurrentSetting(percent);
 
-	driver_current_.ihold = hold_current;
+	IHOLD_IRUN::ihold::set(driver_current_, hold_current);
 	writeStoredDriverCurrent();
 }
 
 void TMC2209::setHoldDelay(uint8_t percent) {
 	uint8_t hold_delay = percentToHoldDelaySetting(percent);
 
-	driver_current_.iholddelay = hold_delay;
+	IHOLD_IRUN::iholddelay::set(driver_current_, hold_delay);
 	writeStoredDriverCurrent();
 }
 
@@ -154,64 +261,64 @@ void TMC2209::setAllCurrentValues(uint8_t run_current_percent,
 	uint8_t hold_current = percentToCurrentSetting(hold_current_percent);
 	uint8_t hold_delay = percentToHoldDelaySetting(hold_delay_percent);
 
-	driver_current_.irun = run_current;
-	driver_current_.ihold = hold_current;
-	driver_current_.iholddelay = hold_delay;
+	driver_current_ = update(driver_current_, IHOLD_IRUN::irun::of(run_current),
+			IHOLD_IRUN::ihold::of(hold_current),
+			IHOLD_IRUN::iholddelay::of(hold_delay));
 	writeStoredDriverCurrent();
 }
 
 void TMC2209::enableDoubleEdge() {
-	chopper_config_.double_edge = DOUBLE_EDGE_ENABLE;
+	CHOPCONF::dedge::set(chopper_config_, DOUBLE_EDGE_ENABLE);
 	writeStoredChopperConfig();
 }
 
 void TMC2209::disableDoubleEdge() {
-	chopper_config_.double_edge = DOUBLE_EDGE_DISABLE;
+	CHOPCONF::dedge::set(chopper_config_, DOUBLE_EDGE_DISABLE);
 	writeStoredChopperConfig();
 }
 
 void TMC2209::enableInverseMotorDirection() {
-	global_config_.shaft = 1;
+	GCONF::shaft::set(global_config_, 1);
 	writeStoredGlobalConfig();
 }
 
 void TMC2209::disableInverseMotorDirection() {
-	global_config_.shaft = 0;
+	GCONF::shaft::set(global_config_, 0);
 	writeStoredGlobalConfig();
 }
 
 void TMC2209::setStandstillMode(TMC2209::StandstillMode mode) {
-	pwm_config_.freewheel = mode;
+	PWMCONF::freewheel::set(pwm_config_, mode);
 	writeStoredPwmConfig();
 }
 
 void TMC2209::enableAutomaticCurrentScaling() {
-	pwm_config_.pwm_autoscale = STEPPER_DRIVER_FEATURE_ON;
+	PWMCONF::pwm_autoscale::set(pwm_config_, STEPPER_DRIVER_FEATURE_ON);
 	writeStoredPwmConfig();
 }
 
 void TMC2209::disableAutomaticCurrentScaling() {
-	pwm_config_.pwm_autoscale = STEPPER_DRIVER_FEATURE_OFF;
+	PWMCONF::pwm_autoscale::set(pwm_config_, STEPPER_DRIVER_FEATURE_OFF);
 	writeStoredPwmConfig();
 }
 
 void TMC2209::enableAutomaticGradientAdaptation() {
-	pwm_config_.pwm_autograd = STEPPER_DRIVER_FEATURE_ON;
+	PWMCONF::pwm_autograd::set(pwm_config_, STEPPER_DRIVER_FEATURE_ON);
 	writeStoredPwmConfig();
 }
 
 void TMC2209::disableAutomaticGradientAdaptation() {
-	pwm_config_.pwm_autograd = STEPPER_DRIVER_FEATURE_OFF;
+	PWMCONF::pwm_autograd::set(pwm_config_, STEPPER_DRIVER_FEATURE_OFF);
 	writeStoredPwmConfig();
 }
 
 void TMC2209::setPwmOffset(uint8_t pwm_amplitude) {
-	pwm_config_.pwm_offset = pwm_amplitude;
+	PWMCONF::pwm_ofs::set(pwm_config_, pwm_amplitude);
 	writeStoredPwmConfig();
 }
 
 void TMC2209::setPwmGradient(uint8_t pwm_amplitude) {
-	pwm_config_.pwm_grad = pwm_amplitude;
+	PWMCONF::pwm_grad::set(pwm_config_, pwm_amplitude);
 	writeStoredPwmConfig();
 }
 
@@ -223,10 +330,7 @@ void TMC2209::setReplyDelay(uint8_t reply_delay) {
 	if (reply_delay > REPLY_DELAY_MAX) {
 		reply_delay = REPLY_DELAY_MAX;
 	}
-	ReplyDelay reply_delay_data;
-	reply_delay_data.bytes = 0;
-	reply_delay_data.replydelay = reply_delay;
-	write(ADDRESS_REPLYDELAY, reply_delay_data.bytes);
+	write(ADDRESS_REPLYDELAY, compose(NODECONF::senddelay::of(reply_delay)));
 }
 
 void TMC2209::moveAtVelocity(int32_t microsteps_per_period) {
@@ -237,13 +341,65 @@ void TMC2209::moveUsingStepDirInterface() {
 	write(ADDRESS_VACTUAL, VACTUAL_STEP_DIR_INTERFACE);
 }
 
+void TMC2209::flush(uint8_t repetitions) {
+	for (auto &shadow : shadow_registers_) {
+		if (!shadow.dirty)
+			continue;
+		if (shadow.address == ADDRESS_VACTUAL
+				&& velocity_lost_write_callback_ != nullptr) {
+			shadow.dirty = false;
+			continue;
+		}
+		for (uint8_t i = 0; i < repetitions; ++i) {
+			writeDatagram(shadow.address, shadow.value);
+		}
+		shadow.dirty = false;
+		unverified_registers_ |= shadowRegisterBit(&shadow);
+	}
+}
+
+void TMC2209::delegateVelocity(LostWriteCallback on_lost_write,
+		void *context) {
+	velocity_lost_write_callback_ = on_lost_write;
+	velocity_lost_write_context_ = context;
+	// Whatever VACTUAL is still waiting is the new owner's business now.
+	findShadowRegister(ADDRESS_VACTUAL)->dirty = false;
+}
+
+uint8_t TMC2209::getSerialAddress() {
+	return serial_address_;
+}
+
+void TMC2209::invalidateShadowRegisters() {
+	for (auto &shadow : shadow_registers_) {
+		shadow.dirty = shadow.valid;
+	}
+}
+
+void TMC2209::verifyWrites() {
+	if (verify_pending_) {
+		if (!verify_done_)
+			return;
+		verify_pending_ = false;
+		checkWriteVerification();
+	}
+	if (bus_ != nullptr
+			&& bus_->writes_sent(serial_address_) != writes_at_interface_counter_) {
+		startWriteVerification();
+	}
+}
+
+uint32_t TMC2209::getLostWriteCount() {
+	return lost_writes_;
+}
+
 void TMC2209::enableStealthChop() {
-	global_config_.enable_spread_cycle = 0;
+	GCONF::en_spreadcycle::set(global_config_, 0);
 	writeStoredGlobalConfig();
 }
 
 void TMC2209::disableStealthChop() {
-	global_config_.enable_spread_cycle = 1;
+	GCONF::en_spreadcycle::set(global_config_, 1);
 	writeStoredGlobalConfig();
 }
 
@@ -261,56 +417,53 @@ void TMC2209::setStallGuardThreshold(uint8_t stall_guard_threshold) {
 
 void TMC2209::enableCoolStep(uint8_t lower_threshold, uint8_t upper_threshold) {
 	lower_threshold = constrain_(lower_threshold, SEMIN_MIN, SEMIN_MAX);
-	cool_config_.semin = lower_threshold;
 	upper_threshold = constrain_(upper_threshold, SEMAX_MIN, SEMAX_MAX);
-	cool_config_.semax = upper_threshold;
-	write(ADDRESS_COOLCONF, cool_config_.bytes);
+	cool_config_ = update(cool_config_, COOLCONF::semin::of(lower_threshold),
+			COOLCONF::semax::of(upper_threshold));
+	write(ADDRESS_COOLCONF, cool_config_);
 	cool_step_enabled_ = true;
 }
 
 void TMC2209::disableCoolStep() {
-	cool_config_.semin = SEMIN_OFF;
-	write(ADDRESS_COOLCONF, cool_config_.bytes);
+	COOLCONF::semin::set(cool_config_, SEMIN_OFF);
+	write(ADDRESS_COOLCONF, cool_config_);
 	cool_step_enabled_ = false;
 }
 
 void TMC2209::setCoolStepCurrentIncrement(CurrentIncrement current_increment) {
-	cool_config_.seup = current_increment;
-	write(ADDRESS_COOLCONF, cool_config_.bytes);
+	COOLCONF::seup::set(cool_config_, current_increment);
+	write(ADDRESS_COOLCONF, cool_config_);
 }
 
 void TMC2209::setCoolStepMeasurementCount(MeasurementCount measurement_count) {
-	cool_config_.sedn = measurement_count;
-	write(ADDRESS_COOLCONF, cool_config_.bytes);
+	COOLCONF::sedn::set(cool_config_, measurement_count);
+	write(ADDRESS_COOLCONF, cool_config_);
 }
 
 void TMC2209::enableAnalogCurrentScaling() {
-	global_config_.i_scale_analog = 1;
+	GCONF::i_scale_analog::set(global_config_, 1);
 	writeStoredGlobalConfig();
 }
 
 void TMC2209::disableAnalogCurrentScaling() {
-	global_config_.i_scale_analog = 0;
+	GCONF::i_scale_analog::set(global_config_, 0);
 	writeStoredGlobalConfig();
 }
 
 void TMC2209::useExternalSenseResistors() {
-	global_config_.internal_rsense = 0;
+	GCONF::internal_rsense::set(global_config_, 0);
 	writeStoredGlobalConfig();
 }
 
 void TMC2209::useInternalSenseResistors() {
-	global_config_.internal_rsense = 1;
+	GCONF::internal_rsense::set(global_config_, 1);
 	writeStoredGlobalConfig();
 }
 
 // bidirectional methods
 
 uint8_t TMC2209::getVersion() {
-	Input input;
-	input.bytes = read(ADDRESS_IOIN);
-
-	return input.version;
+	return IOIN::version::get(read(ADDRESS_IOIN));
 }
 
 bool TMC2209::isCommunicating() {
@@ -326,15 +479,12 @@ bool TMC2209::isCommunicatingButNotSetup() {
 }
 
 bool TMC2209::hardwareDisabled() {
-	Input input;
-	input.bytes = read(ADDRESS_IOIN);
-
-	return input.enn;
+	return IOIN::enn::get(read(ADDRESS_IOIN));
 }
 
 uint16_t TMC2209::getMicrostepsPerStep() {
 	uint16_t microsteps_per_step_exponent;
-	switch (chopper_config_.mres) {
+	switch (CHOPCONF::mres::get(chopper_config_)) {
 	case MRES_001: {
 		microsteps_per_step_exponent = 0;
 		break;
@@ -383,35 +533,43 @@ TMC2209::Settings TMC2209::getSettings() {
 	if (settings.is_communicating) {
 		readAndStoreRegisters();
 
-		settings.is_setup = global_config_.pdn_disable;
-		settings.software_enabled = (chopper_config_.toff > TOFF_DISABLE);
+		settings.is_setup = GCONF::pdn_disable::get(global_config_);
+		settings.software_enabled = (CHOPCONF::toff::get(chopper_config_)
+				> TOFF_DISABLE);
 		settings.microsteps_per_step = getMicrostepsPerStep();
-		settings.inverse_motor_direction_enabled = global_config_.shaft;
-		settings.stealth_chop_enabled = not global_config_.enable_spread_cycle;
-		settings.standstill_mode = pwm_config_.freewheel;
-		settings.irun_percent = currentSettingToPercent(driver_current_.irun);
-		settings.irun_register_value = driver_current_.irun;
-		settings.ihold_percent = currentSettingToPercent(driver_current_.ihold);
-		settings.ihold_register_value = driver_current_.ihold;
+		settings.inverse_motor_direction_enabled = GCONF::shaft::get(
+				global_config_);
+		settings.stealth_chop_enabled = not GCONF::en_spreadcycle::get(
+				global_config_);
+		settings.standstill_mode = PWMCONF::freewheel::get(pwm_config_);
+		settings.irun_register_value = IHOLD_IRUN::irun::get(driver_current_);
+		settings.irun_percent = currentSettingToPercent(
+				settings.irun_register_value);
+		settings.ihold_register_value = IHOLD_IRUN::ihold::get(driver_current_);
+		settings.ihold_percent = currentSettingToPercent(
+				settings.ihold_register_value);
+		settings.iholddelay_register_value = IHOLD_IRUN::iholddelay::get(
+				driver_current_);
 		settings.iholddelay_percent = holdDelaySettingToPercent(
-				driver_current_.iholddelay);
-		settings.iholddelay_register_value = driver_current_.iholddelay;
-		settings.automatic_current_scaling_enabled = pwm_config_.pwm_autoscale;
+				settings.iholddelay_register_value);
+		settings.automatic_current_scaling_enabled =
+				PWMCONF::pwm_autoscale::get(pwm_config_);
 		settings.automatic_gradient_adaptation_enabled =
-				pwm_config_.pwm_autograd;
-		settings.pwm_offset = pwm_config_.pwm_offset;
-		settings.pwm_gradient = pwm_config_.pwm_grad;
+				PWMCONF::pwm_autograd::get(pwm_config_);
+		settings.pwm_offset = PWMCONF::pwm_ofs::get(pwm_config_);
+		settings.pwm_gradient = PWMCONF::pwm_grad::get(pwm_config_);
 		settings.cool_step_enabled = cool_step_enabled_;
-		settings.analog_current_scaling_enabled = global_config_.i_scale_analog;
-		settings.internal_sense_resistors_enabled =
-				global_config_.internal_rsense;
+		settings.analog_current_scaling_enabled = GCONF::i_scale_analog::get(
+				global_config_);
+		settings.internal_sense_resistors_enabled = GCONF::internal_rsense::get(
+				global_config_);
 	} else {
 		settings.is_setup = false;
 		settings.software_enabled = false;
 		settings.microsteps_per_step = 0;
 		settings.inverse_motor_direction_enabled = false;
 		settings.stealth_chop_enabled = false;
-		settings.standstill_mode = pwm_config_.freewheel;
+		settings.standstill_mode = PWMCONF::freewheel::get(pwm_config_);
 		settings.irun_percent = 0;
 		settings.irun_register_value = 0;
 		settings.ihold_percent = 0;
@@ -431,31 +589,41 @@ TMC2209::Settings TMC2209::getSettings() {
 }
 
 TMC2209::Status TMC2209::getStatus() {
-	DriveStatus drive_status;
-	drive_status.bytes = 0;
-	drive_status.bytes = read(ADDRESS_DRV_STATUS);
-	return drive_status.status;
+	const uint32_t drv_status = read(ADDRESS_DRV_STATUS);
+	Status status { };
+	status.over_temperature_warning = DRV_STATUS::otpw::get(drv_status);
+	status.over_temperature_shutdown = DRV_STATUS::ot::get(drv_status);
+	status.short_to_ground_a = DRV_STATUS::s2ga::get(drv_status);
+	status.short_to_ground_b = DRV_STATUS::s2gb::get(drv_status);
+	status.low_side_short_a = DRV_STATUS::s2vsa::get(drv_status);
+	status.low_side_short_b = DRV_STATUS::s2vsb::get(drv_status);
+	status.open_load_a = DRV_STATUS::ola::get(drv_status);
+	status.open_load_b = DRV_STATUS::olb::get(drv_status);
+	status.over_temperature_120c = DRV_STATUS::t120::get(drv_status);
+	status.over_temperature_143c = DRV_STATUS::t143::get(drv_status);
+	status.over_temperature_150c = DRV_STATUS::t150::get(drv_status);
+	status.over_temperature_157c = DRV_STATUS::t157::get(drv_status);
+	status.current_scaling = DRV_STATUS::cs_actual::get(drv_status);
+	status.stealth_chop_mode = DRV_STATUS::stealth::get(drv_status);
+	status.standstill = DRV_STATUS::stst::get(drv_status);
+	return status;
 }
 
 TMC2209::GlobalStatus TMC2209::getGlobalStatus() {
-	GlobalStatusUnion global_status_union;
-	global_status_union.bytes = 0;
-	global_status_union.bytes = read(ADDRESS_GSTAT);
-	return global_status_union.global_status;
+	const uint32_t gstat = read(ADDRESS_GSTAT);
+	GlobalStatus global_status { };
+	global_status.reset = GSTAT::reset::get(gstat);
+	global_status.drv_err = GSTAT::drv_err::get(gstat);
+	global_status.uv_cp = GSTAT::uv_cp::get(gstat);
+	return global_status;
 }
 
 void TMC2209::clearReset() {
-	GlobalStatusUnion global_status_union;
-	global_status_union.bytes = 0;
-	global_status_union.global_status.reset = 1;
-	write(ADDRESS_GSTAT, global_status_union.bytes);
+	write(ADDRESS_GSTAT, compose(GSTAT::reset::of(1)));
 }
 
 void TMC2209::clearDriveError() {
-	GlobalStatusUnion global_status_union;
-	global_status_union.bytes = 0;
-	global_status_union.global_status.drv_err = 1;
-	write(ADDRESS_GSTAT, global_status_union.bytes);
+	write(ADDRESS_GSTAT, compose(GSTAT::drv_err::of(1)));
 }
 
 uint8_t TMC2209::getInterfaceTransmissionCounter() {
@@ -471,31 +639,19 @@ uint16_t TMC2209::getStallGuardResult() {
 }
 
 uint8_t TMC2209::getPwmScaleSum() {
-	PwmScale pwm_scale;
-	pwm_scale.bytes = read(ADDRESS_PWM_SCALE);
-
-	return pwm_scale.pwm_scale_sum;
+	return PWM_SCALE::pwm_scale_sum::get(read(ADDRESS_PWM_SCALE));
 }
 
 int16_t TMC2209::getPwmScaleAuto() {
-	PwmScale pwm_scale;
-	pwm_scale.bytes = read(ADDRESS_PWM_SCALE);
-
-	return pwm_scale.pwm_scale_auto;
+	return PWM_SCALE::pwm_scale_auto::get_signed(read(ADDRESS_PWM_SCALE));
 }
 
 uint8_t TMC2209::getPwmOffsetAuto() {
-	PwmAuto pwm_auto;
-	pwm_auto.bytes = read(ADDRESS_PWM_AUTO);
-
-	return pwm_auto.pwm_offset_auto;
+	return PWM_AUTO::pwm_ofs_auto::get(read(ADDRESS_PWM_AUTO));
 }
 
 uint8_t TMC2209::getPwmGradientAuto() {
-	PwmAuto pwm_auto;
-	pwm_auto.bytes = read(ADDRESS_PWM_AUTO);
-
-	return pwm_auto.pwm_gradient_auto;
+	return PWM_AUTO::pwm_grad_auto::get(read(ADDRESS_PWM_AUTO));
 }
 
 uint16_t TMC2209::getMicrostepCounter() {
@@ -503,10 +659,9 @@ uint16_t TMC2209::getMicrostepCounter() {
 }
 
 // private
-void TMC2209::initialize(UART_HandleTypeDef *new_huart, long serial_baud_rate,
+void TMC2209::initialize(TMC2209Bus *bus, long serial_baud_rate,
 		SerialAddress serial_address) {
-	this->huart_ = new_huart;
-	serial_baud_rate_ = serial_baud_rate;
+	attach(bus, serial_baud_rate, serial_address);
 
 	setOperationModeToSerial(serial_address);
 	setRegistersToDefaults();
@@ -521,34 +676,29 @@ void TMC2209::initialize(UART_HandleTypeDef *new_huart, long serial_baud_rate,
 void TMC2209::setOperationModeToSerial(SerialAddress serial_address) {
 	serial_address_ = serial_address;
 
-	global_config_.bytes = 0;
-	global_config_.i_scale_analog = 0;
-	global_config_.pdn_disable = 1;
-	global_config_.mstep_reg_select = 1;
-	global_config_.multistep_filt = 1;
+	global_config_ = compose(GCONF::i_scale_analog::of(0),
+			GCONF::pdn_disable::of(1), GCONF::mstep_reg_select::of(1),
+			GCONF::multistep_filt::of(1));
 
 	writeStoredGlobalConfig();
 }
 
 void TMC2209::setRegistersToDefaults() {
-	driver_current_.bytes = 0;
-	driver_current_.ihold = IHOLD_DEFAULT;
-	driver_current_.irun = IRUN_DEFAULT;
-	driver_current_.iholddelay = IHOLDDELAY_DEFAULT;
-	write(ADDRESS_IHOLD_IRUN, driver_current_.bytes);
+	driver_current_ = compose(IHOLD_IRUN::ihold::of(IHOLD_DEFAULT),
+			IHOLD_IRUN::irun::of(IRUN_DEFAULT),
+			IHOLD_IRUN::iholddelay::of(IHOLDDELAY_DEFAULT));
+	write(ADDRESS_IHOLD_IRUN, driver_current_);
 
-	chopper_config_.bytes = CHOPPER_CONFIG_DEFAULT;
-	chopper_config_.tbl = TBL_DEFAULT;
-	chopper_config_.hend = HEND_DEFAULT;
-	chopper_config_.hstart = HSTART_DEFAULT;
-	chopper_config_.toff = TOFF_DEFAULT;
-	write(ADDRESS_CHOPCONF, chopper_config_.bytes);
+	chopper_config_ = update(CHOPPER_CONFIG_DEFAULT,
+			CHOPCONF::tbl::of(TBL_DEFAULT), CHOPCONF::hend::of(HEND_DEFAULT),
+			CHOPCONF::hstrt::of(HSTART_DEFAULT), CHOPCONF::toff::of(TOFF_DEFAULT));
+	write(ADDRESS_CHOPCONF, chopper_config_);
 
-	pwm_config_.bytes = PWM_CONFIG_DEFAULT;
-	write(ADDRESS_PWMCONF, pwm_config_.bytes);
+	pwm_config_ = PWM_CONFIG_DEFAULT;
+	write(ADDRESS_PWMCONF, pwm_config_);
 
-	cool_config_.bytes = COOLCONF_DEFAULT;
-	write(ADDRESS_COOLCONF, cool_config_.bytes);
+	cool_config_ = COOLCONF_DEFAULT;
+	write(ADDRESS_COOLCONF, cool_config_);
 
 	write(ADDRESS_TPOWERDOWN, TPOWERDOWN_DEFAULT);
 	write(ADDRESS_TPWMTHRS, TPWMTHRS_DEFAULT);
@@ -559,151 +709,141 @@ void TMC2209::setRegistersToDefaults() {
 }
 
 void TMC2209::readAndStoreRegisters() {
-	global_config_.bytes = readGlobalConfigBytes();
-	chopper_config_.bytes = readChopperConfigBytes();
-	pwm_config_.bytes = readPwmConfigBytes();
+	global_config_ = readGlobalConfigBytes();
+	chopper_config_ = readChopperConfigBytes();
+	pwm_config_ = readPwmConfigBytes();
 }
 
 bool TMC2209::serialOperationMode() {
-	GlobalConfig global_config;
-	global_config.bytes = readGlobalConfigBytes();
-
-	return global_config.pdn_disable;
+	return GCONF::pdn_disable::get(readGlobalConfigBytes());
 }
 
 void TMC2209::minimizeMotorCurrent() {
-	driver_current_.irun = CURRENT_SETTING_MIN;
-	driver_current_.ihold = CURRENT_SETTING_MIN;
+	driver_current_ = update(driver_current_,
+			IHOLD_IRUN::irun::of(CURRENT_SETTING_MIN),
+			IHOLD_IRUN::ihold::of(CURRENT_SETTING_MIN));
 	writeStoredDriverCurrent();
 }
 
-uint32_t TMC2209::reverseData(uint32_t data) {
-	uint32_t reversed_data = 0;
-	uint8_t right_shift;
-	uint8_t left_shift;
-	for (uint8_t i = 0; i < DATA_SIZE; ++i) {
-		right_shift = (DATA_SIZE - i - 1) * BITS_PER_BYTE;
-		left_shift = i * BITS_PER_BYTE;
-		reversed_data |= ((data >> right_shift) & BYTE_MAX_VALUE) << left_shift;
-	}
-	return reversed_data;
-}
-
-template<typename Datagram>
-uint8_t TMC2209::calculateCrc(Datagram &datagram, uint8_t datagram_size) {
-	uint8_t crc = 0;
-	uint8_t byte;
-	for (uint8_t i = 0; i < (datagram_size - 1); ++i) {
-		byte = (datagram.bytes >> (i * BITS_PER_BYTE)) & BYTE_MAX_VALUE;
-		for (uint8_t j = 0; j < BITS_PER_BYTE; ++j) {
-			if ((crc >> 7) ^ (byte & 0x01)) {
-				crc = (crc << 1) ^ 0x07;
-			} else {
-				crc = crc << 1;
-			}
-			byte = byte >> 1;
-		}
+TMC2209::ShadowRegister* TMC2209::findShadowRegister(
+		uint8_t register_address) {
+	for (auto &shadow : shadow_registers_) {
+		if (shadow.address == register_address)
+			return &shadow;
 	}
-	return crc;
+	return nullptr;
 }
 
-template<typename Datagram>
-void TMC2209::sendDatagramUnidirectional(Datagram &datagram,
-		uint8_t datagram_size) {
-	uint8_t byte;
+uint16_t TMC2209::shadowRegisterBit(const ShadowRegister *shadow) {
+	return 1 << (shadow - shadow_registers_);
+}
 
-//	HAL_HalfDuplex_EnableTransmitter(huart_);
-	for (uint8_t i = 0; i < datagram_size; ++i) {
-		byte = (datagram.bytes >> (i * BITS_PER_BYTE)) & BYTE_MAX_VALUE;
-		auto status = HAL_UART_Transmit(huart_, &byte, 1, 1000);
-		if (status != HAL_OK) {
-			BSP_LED_On(LED_GREEN);
-		}
+void TMC2209::startWriteVerification() {
+	verifying_registers_ = unverified_registers_;
+	unverified_registers_ = 0;
+	verify_done_ = false;
+	verify_pending_ = readAsync(ADDRESS_IFCNT, onInterfaceCounter, this);
+	if (!verify_pending_) {
+		unverified_registers_ |= verifying_registers_;
 	}
 }
 
-template<typename Datagram>
-void TMC2209::sendDatagramBidirectional(Datagram &datagram,
-		uint8_t datagram_size) {
-
-//	HAL_HalfDuplex_EnableReceiver(huart_);
+void TMC2209::onInterfaceCounter(void *context, bool ok, uint32_t data) {
+	// Called from the bus interrupt: only take the reading, the thread mode side does the rest.
+	auto *self = static_cast<TMC2209*>(context);
+	self->verify_ok_ = ok;
+	self->verify_interface_counter_ = data;
+	self->verify_writes_ = self->bus_->writes_sent(self->serial_address_);
+	self->verify_done_ = true;
+}
 
-	// clear the serial receive buffer if necessary
-	while (__HAL_UART_GET_FLAG(huart_, UART_FLAG_RXNE)) {
-		// Read the received data to clear the RXNE flag
-		uint8_t dummy;
-		HAL_UART_Receive(huart_, &dummy, 1, 0);
+void TMC2209::checkWriteVerification() {
+	if (!verify_ok_) {
+		// No reply, check these along with the next ones.
+		unverified_registers_ |= verifying_registers_;
+		return;
 	}
 
-//	HAL_HalfDuplex_EnableTransmitter(huart_);
-
-	// write datagram
-	for (uint8_t i = 0; i < datagram_size; ++i) {
-		uint8_t byte = (datagram.bytes >> (i * BITS_PER_BYTE)) & BYTE_MAX_VALUE;
-		auto status = HAL_UART_Transmit(huart_, &byte, 1, 100);
-		if (status != HAL_OK) {
-			HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_SET);
-			return;
+	uint16_t resend = 0;
+	if (!interface_counter_valid_) {
+		// Nothing to compare with: whatever went out before can't be vouched for.
+		resend = verifying_registers_;
+	} else {
+		// IFCNT is 8 bits wide, and so is the comparison.
+		const uint8_t sent = verify_writes_ - writes_at_interface_counter_;
+		const uint8_t accepted = verify_interface_counter_ - interface_counter_;
+		if (accepted != sent) {
+			lost_writes_ += static_cast<uint8_t>(sent - accepted);
+			resend = verifying_registers_;
+			if (velocity_lost_write_callback_ != nullptr) {
+				velocity_lost_write_callback_(velocity_lost_write_context_,
+						serial_address_);
+			}
 		}
 	}
+	interface_counter_valid_ = true;
+	interface_counter_ = verify_interface_counter_;
+	writes_at_interface_counter_ = verify_writes_;
 
-//	HAL_HalfDuplex_EnableReceiver(huart_);
-
-	// wait for bytes sent out on TX line to be echoed on RX line
-	uint8_t echo_buf[datagram_size];
-	auto reply_status = HAL_UART_Receive(huart_, echo_buf, datagram_size,
-			ECHO_DELAY_MAX_MICROSECONDS / 1000);
-
-	if (reply_status != HAL_OK) {
+	if (resend == 0)
 		return;
+	for (auto &shadow : shadow_registers_) {
+		if ((resend & shadowRegisterBit(&shadow)) && shadow.valid) {
+			shadow.dirty = true;
+		}
 	}
+	flush();
 }
 
 void TMC2209::write(uint8_t register_address, uint32_t data) {
-	WriteReadReplyDatagram write_datagram;
-	write_datagram.bytes = 0;
-	write_datagram.sync = SYNC;
-	write_datagram.serial_address = serial_address_;
-	write_datagram.register_address = register_address;
-	write_datagram.rw = RW_WRITE;
-	write_datagram.data = reverseData(data);
-	write_datagram.crc = calculateCrc(write_datagram,
-			WRITE_READ_REPLY_DATAGRAM_SIZE);
+	ShadowRegister *shadow = findShadowRegister(register_address);
+	if (shadow == nullptr) {
+		// Write-only or write-to-clear registers (GSTAT) go straight out.
+		writeDatagram(register_address, data);
+		return;
+	}
+	if (!shadow->valid || shadow->value != data) {
+		shadow->value = data;
+		shadow->valid = true;
+		shadow->dirty = true;
+	}
+}
 
-	sendDatagramUnidirectional(write_datagram, WRITE_READ_REPLY_DATAGRAM_SIZE);
+void TMC2209::writeDatagram(uint8_t register_address, uint32_t data) {
+	// Only queued: the bus shifts it out in the background, and discards its echo.
+	bus_->write(serial_address_, register_address, data);
 }
 
 uint32_t TMC2209::read(uint8_t register_address) {
-	ReadRequestDatagram read_request_datagram;
-	read_request_datagram.bytes = 0;
-	read_request_datagram.sync = SYNC;
-	read_request_datagram.serial_address = serial_address_;
-	read_request_datagram.register_address = register_address;
-	read_request_datagram.rw = RW_READ;
-	read_request_datagram.crc = calculateCrc(read_request_datagram,
-			READ_REQUEST_DATAGRAM_SIZE);
-
-	sendDatagramBidirectional(read_request_datagram,
-			READ_REQUEST_DATAGRAM_SIZE);
-
-//	HAL_HalfDuplex_EnableReceiver(huart_);
-
-	uint8_t reply_buf[WRITE_READ_REPLY_DATAGRAM_SIZE];
-	auto reply_status = HAL_UART_Receive(huart_, reply_buf, WRITE_READ_REPLY_DATAGRAM_SIZE, REPLY_DELAY_MAX_MICROSECONDS / 1000);
-	if (reply_status != HAL_OK) {
+	// Blocking reads can't be waited for from an interrupt, the bus is driven by interrupts itself.
+	if (__get_IPSR() != 0) {
 		return 0;
 	}
 
-	uint64_t byte;
-	uint8_t byte_count = 0;
-	WriteReadReplyDatagram read_reply_datagram;
-	read_reply_datagram.bytes = 0;
-	for (uint8_t i = 0; i < WRITE_READ_REPLY_DATAGRAM_SIZE; ++i) {
-		byte = reply_buf[i];
-		read_reply_datagram.bytes |= (byte << (byte_count++ * BITS_PER_BYTE));
+	// Pending writes go out first, or we might read back a stale value.
+	flush();
+
+	struct PendingRead {
+		volatile bool done;
+		uint32_t data;
+	} pending { false, 0 };
+	auto on_reply = [](void *context, bool ok, uint32_t data) {
+		auto *pending = static_cast<PendingRead*>(context);
+		pending->data = data;
+		pending->done = true;
+	};
+	if (!readAsync(register_address, on_reply, &pending)) {
+		return 0;
+	}
+	while (!pending.done) {
+		__WFI();
 	}
+	return pending.data;
+}
 
-	return reverseData(read_reply_datagram.data);
+bool TMC2209::readAsync(uint8_t register_address,
+		TMC2209Bus::Callback callback, void *context) {
+	return bus_->read(serial_address_, register_address, callback, context);
 }
 
 uint8_t TMC2209::percentToCurrentSetting(uint8_t percent) {
@@ -733,7 +873,7 @@ uint8_t TMC2209::holdDelaySettingToPercent(uint8_t hold_delay_setting) {
 }
 
 void TMC2209::writeStoredGlobalConfig() {
-	write(ADDRESS_GCONF, global_config_.bytes);
+	write(ADDRESS_GCONF, global_config_);
 }
 
 uint32_t TMC2209::readGlobalConfigBytes() {
@@ -741,20 +881,20 @@ uint32_t TMC2209::readGlobalConfigBytes() {
 }
 
 void TMC2209::writeStoredDriverCurrent() {
-	write(ADDRESS_IHOLD_IRUN, driver_current_.bytes);
+	write(ADDRESS_IHOLD_IRUN, driver_current_);
 
-	if (driver_current_.irun >= SEIMIN_UPPER_CURRENT_LIMIT) {
-		cool_config_.seimin = SEIMIN_UPPER_SETTING;
+	if (IHOLD_IRUN::irun::get(driver_current_) >= SEIMIN_UPPER_CURRENT_LIMIT) {
+		COOLCONF::seimin::set(cool_config_, SEIMIN_UPPER_SETTING);
 	} else {
-		cool_config_.seimin = SEIMIN_LOWER_SETTING;
+		COOLCONF::seimin::set(cool_config_, SEIMIN_LOWER_SETTING);
 	}
 	if (cool_step_enabled_) {
-		write(ADDRESS_COOLCONF, cool_config_.bytes);
+		write(ADDRESS_COOLCONF, cool_config_);
 	}
 }
 
 void TMC2209::writeStoredChopperConfig() {
-	write(ADDRESS_CHOPCONF, chopper_config_.bytes);
+	write(ADDRESS_CHOPCONF, chopper_config_);
 }
 
 uint32_t TMC2209::readChopperConfigBytes() {
@@ -762,7 +902,7 @@ uint32_t TMC2209::readChopperConfigBytes() {
 }
 
 void TMC2209::writeStoredPwmConfig() {
-	write(ADDRESS_PWMCONF, pwm_config_.bytes);
+	write(ADDRESS_PWMCONF, pwm_config_);
 }
 
 uint32_t TMC2209::readPwmConfigBytes() {
@@ -772,3 +912,40 @@ uint32_t TMC2209::readPwmConfigBytes() {
 uint32_t TMC2209::constrain_(uint32_t value, uint32_t low, uint32_t high) {
 	return ((value) < (low) ? (low) : ((value) > (high) ? (high) : (value)));
 }
+
+void TMC2209::adoptRegisterImage(const RegisterImage &image) {
+	for (const RegisterWrite &write : image) {
+		switch (write.address) {
+		case ADDRESS_GCONF:
+			global_config_ = write.value;
+			break;
+		case ADDRESS_IHOLD_IRUN:
+			driver_current_ = write.value;
+			break;
+		case ADDRESS_CHOPCONF:
+			chopper_config_ = write.value;
+			if (CHOPCONF::toff::get(chopper_config_) != TOFF_DISABLE) {
+				toff_ = CHOPCONF::toff::get(chopper_config_);
+			}
+			break;
+		case ADDRESS_PWMCONF:
+			pwm_config_ = write.value;
+			break;
+		case ADDRESS_COOLCONF:
+			cool_config_ = write.value;
+			cool_step_enabled_ = COOLCONF::semin::get(cool_config_) != SEMIN_OFF;
+			break;
+		default:
+			break;
+		}
+
+		// Already on its way: up to date, but still to be checked against IFCNT.
+		ShadowRegister *shadow = findShadowRegister(write.address);
+		if (shadow == nullptr)
+			continue;
+		shadow->value = write.value;
+		shadow->valid = true;
+		shadow->dirty = false;
+		unverified_registers_ |= shadowRegisterBit(shadow);
+	}
+}
@@ -33,12 +33,18 @@ LICENSE:
 /**********************    INCLUDE DIRECTIVES    ***********************/
 
 #include "peripherals/as5600.h"
+
+#include <string.h>
 /**********************    GLOBAL VARIABLES    ***********************/
 
 /*******************    FUNCTION IMPLEMENTATIONS    ********************/
-AS5600_TypeDef *AS5600_New(void) {
-    AS5600_TypeDef *a = (AS5600_TypeDef *)calloc(1, sizeof(AS5600_TypeDef));
-    return a;
+/* Zeroes the caller's structure, leaving every option at its default, and
+   attaches it to its bus. No allocation: the structure can be static. */
+void AS5600_Construct(AS5600_TypeDef *a, I2C_HandleTypeDef *i2cHandle,
+                      uint8_t i2cAddr) {
+    memset(a, 0, sizeof(*a));
+    a->i2cHandle = i2cHandle;
+    a->i2cAddr = i2cAddr;
 }
 
 HAL_StatusTypeDef AS5600_Init(AS5600_TypeDef *a) {
@@ -0,0 +1,136 @@
+#include "peripherals/as5600_bus.hpp"
+
+#include "critical_section.hpp"
+#include "cycle_counter.hpp"
+#include "timebase.hpp"
+
+void AS5600Bus::init(I2C_HandleTypeDef *hi2c, Callback callback,
+		void *context) {
+	hi2c_ = hi2c;
+	callback_ = callback;
+	context_ = context;
+
+	// SCL low timeout in units of 2048 kernel clocks, TIMEOUTA can only be written with the timeout disabled.
+	const uint32_t clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_I2C1);
+	const uint32_t units = (uint64_t) ENCODER_BUS_TIMEOUT_US * clock
+			/ (2048 * 1000000);
+	CLEAR_BIT(hi2c_->Instance->TIMEOUTR, I2C_TIMEOUTR_TIMOUTEN);
+	MODIFY_REG(hi2c_->Instance->TIMEOUTR,
+			I2C_TIMEOUTR_TIMEOUTA | I2C_TIMEOUTR_TIDLE,
+			(units > 0 ? units - 1 : 0) & I2C_TIMEOUTR_TIMEOUTA);
+	SET_BIT(hi2c_->Instance->TIMEOUTR, I2C_TIMEOUTR_TIMOUTEN);
+}
+
+bool AS5600Bus::start(void) {
+	CriticalSection cs;
+	if (hi2c_ == nullptr || locked_ || in_flight())
+		return false;
+
+	busy_ = true;
+	wheel_ = 0;
+	started_at_ = cycle_counter();
+	// Left over from a blocking transfer, which runs with the error interrupt off.
+	__HAL_I2C_CLEAR_FLAG(hi2c_, I2C_FLAG_TIMEOUT);
+	if (!select_wheel()) {
+		finish(false);
+		return false;
+	}
+	return true;
+}
+
+void AS5600Bus::lock(void) {
+	locked_ = true;
+	while (true) {
+		{
+			CriticalSection cs;
+			if (!in_flight())
+				return;
+		}
+		__WFI(); // Wait for the acquisition in flight to complete.
+	}
+}
+
+void AS5600Bus::unlock(void) {
+	locked_ = false;
+}
+
+void AS5600Bus::on_tx_complete(void) {
+	if (!busy_)
+		return;
+	read_started_at_ = micros();
+	if (HAL_I2C_Mem_Read_IT(hi2c_, AS5600_ADDR, AS5600_REGISTER_ANGLE_HIGH,
+	I2C_MEMADD_SIZE_8BIT, angle_, sizeof(angle_)) != HAL_OK) {
+		finish(false);
+	}
+}
+
+void AS5600Bus::on_rx_complete(void) {
+	if (!busy_)
+		return;
+	sample_.counts[wheel_] = ((angle_[0] << 8) | angle_[1]) & 0x0FFF;
+	// The angle is latched somewhere in the read, which takes about 0.5 ms at 100 kHz.
+	sample_.timestamps_us[wheel_] = us_midpoint(read_started_at_, micros());
+	if (++wheel_ == WHEEL_COUNT) {
+		finish(true);
+	} else if (!select_wheel()) {
+		finish(false);
+	}
+}
+
+void AS5600Bus::on_error(void) {
+	if (!busy_)
+		return;
+	// HAL cleans up after a NACK or a bus error itself, not after the SCL low timeout, which it doesn't handle.
+	if (hi2c_->ErrorCode & HAL_I2C_ERROR_TIMEOUT) {
+		++timeouts_;
+	}
+	if (hi2c_->State != HAL_I2C_STATE_READY) {
+		recover();
+	}
+	finish(false);
+}
+
+bool AS5600Bus::select_wheel(void) {
+	select_ = tca9548a_select(encoder_mux_channel(wheel_));
+	return HAL_I2C_Master_Transmit_IT(hi2c_, TCA9548A_ADDR, &select_, 1)
+			== HAL_OK;
+}
+
+bool AS5600Bus::in_flight(void) {
+	if (!busy_)
+		return false;
+	if (cycles_to_us(cycle_counter() - started_at_)
+			< ENCODER_ACQUISITION_TIMEOUT_US)
+		return true;
+
+	++timeouts_;
+	recover();
+	finish(false);
+	return false;
+}
+
+void AS5600Bus::finish(bool ok) {
+	if (!ok) {
+		++failed_;
+	}
+	busy_ = false;
+	if (callback_ != nullptr) {
+		callback_(context_, ok, sample_);
+	}
+}
+
+void AS5600Bus::recover(void) {
+	__HAL_I2C_DISABLE_IT(hi2c_,
+			I2C_IT_ERRI | I2C_IT_TCI | I2C_IT_STOPI | I2C_IT_NACKI | I2C_IT_ADDRI | I2C_IT_RXI | I2C_IT_TXI);
+	// Software reset: releases the lines and clears the transfer state, keeping the configuration. PE has to stay
+	// low for 3 APB cycles, the read back covers that.
+	__HAL_I2C_DISABLE(hi2c_);
+	(void) READ_REG(hi2c_->Instance->CR1);
+	__HAL_I2C_ENABLE(hi2c_);
+	__HAL_I2C_CLEAR_FLAG(hi2c_, I2C_FLAG_TIMEOUT);
+
+	hi2c_->State = HAL_I2C_STATE_READY;
+	hi2c_->Mode = HAL_I2C_MODE_NONE;
+	hi2c_->XferISR = NULL;
+	__HAL_UNLOCK(hi2c_);
+}
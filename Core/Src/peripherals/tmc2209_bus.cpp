@@ -0,0 +1,185 @@
+#include "peripherals/tmc2209_bus.hpp"
+
+#include "critical_section.hpp"
+
+// Longest silence between a request's echo and its reply, in bit times: REPLYDELAY tops out at 15 * 8 bit times.
+constexpr uint32_t RECEIVER_TIMEOUT_BITS = 15 * 8 + 40;
+
+void TMC2209Bus::init(UART_HandleTypeDef *huart) {
+	huart_ = huart;
+	HAL_UART_ReceiverTimeout_Config(huart_, RECEIVER_TIMEOUT_BITS);
+	HAL_UART_EnableReceiverTimeout(huart_);
+}
+
+template<typename Fill>
+bool TMC2209Bus::submit(Fill fill) {
+	while (true) {
+		{
+			CriticalSection cs;
+			if (head_ - tail_ < TMC_BUS_QUEUE_LENGTH) {
+				fill(queue_[head_ % TMC_BUS_QUEUE_LENGTH]);
+				++head_;
+				start_next();
+				return true;
+			}
+		}
+		if (__get_IPSR() != 0)
+			return false;
+		__WFI(); // Wait for the transaction on the wire to complete.
+	}
+}
+
+bool TMC2209Bus::write(uint8_t serial_address, uint8_t register_address,
+		uint32_t data) {
+	return submit([&](Transaction &t) {
+		tmc_build_write(t.request, serial_address, register_address, data);
+		t.request_len = TMC_WRITE_DATAGRAM_SIZE;
+		t.reply_len = 0;
+		t.callback = nullptr;
+		t.context = nullptr;
+	});
+}
+
+bool TMC2209Bus::read(uint8_t serial_address, uint8_t register_address,
+		Callback callback, void *context) {
+	return submit([&](Transaction &t) {
+		tmc_build_read_request(t.request, serial_address, register_address);
+		t.request_len = TMC_READ_REQUEST_SIZE;
+		t.reply_len = TMC_REPLY_SIZE;
+		t.callback = callback;
+		t.context = context;
+	});
+}
+
+bool TMC2209Bus::write_burst(const uint8_t *serial_addresses,
+		uint8_t register_address, const uint32_t *data, size_t count,
+		Callback callback, void *context) {
+	if (count == 0 || count > MAX_BURST)
+		return false;
+
+	return submit([&](Transaction &t) {
+		for (size_t i = 0; i < count; ++i) {
+			tmc_build_write(t.request + i * TMC_WRITE_DATAGRAM_SIZE,
+					serial_addresses[i], register_address, data[i]);
+		}
+		t.request_len = count * TMC_WRITE_DATAGRAM_SIZE;
+		t.reply_len = 0;
+		t.callback = callback;
+		t.context = context;
+	});
+}
+
+void TMC2209Bus::on_tx_complete(void) {
+	tx_done_ = true;
+	try_complete();
+}
+
+void TMC2209Bus::on_rx_complete(void) {
+	const Transaction &t = queue_[tail_ % TMC_BUS_QUEUE_LENGTH];
+	if (t.reply_len == 0) {
+		datagram_done_at_[rx_received_ / TMC_WRITE_DATAGRAM_SIZE] =
+				cycle_counter();
+		rx_received_ += TMC_WRITE_DATAGRAM_SIZE;
+		// The next datagram's echo is already coming in: with the FIFO off, the receiver holds one byte while the next
+		// one shifts in, so there's a byte time to start receiving it.
+		if (rx_received_ < t.request_len) {
+			if (HAL_UART_Receive_DMA(huart_, rx_buf_ + rx_received_,
+					rx_chunk(t)) != HAL_OK) {
+				rx_done_ = true; // Failed: rx_ok_ stays false.
+				try_complete();
+			}
+			return;
+		}
+	}
+	rx_ok_ = true;
+	rx_done_ = true;
+	try_complete();
+}
+
+void TMC2209Bus::on_error(void) {
+	// HAL has already aborted whichever transfer failed: a receiver timeout (missing reply), a line error, or a DMA
+	// error. Consider those directions done, and the transaction failed.
+	if (huart_->RxState == HAL_UART_STATE_READY) {
+		rx_done_ = true;
+	}
+	if (huart_->gState == HAL_UART_STATE_READY) {
+		tx_done_ = true;
+	}
+	try_complete();
+}
+
+void TMC2209Bus::start_next(void) {
+	while (!busy_ && head_ != tail_) {
+		const Transaction &t = queue_[tail_ % TMC_BUS_QUEUE_LENGTH];
+
+		// Drop anything left over in the receiver, so the echo lines up with the start of the buffer.
+		__HAL_UART_SEND_REQ(huart_, UART_RXDATA_FLUSH_REQUEST);
+		__HAL_UART_CLEAR_FLAG(huart_,
+				UART_CLEAR_OREF | UART_CLEAR_NEF | UART_CLEAR_FEF | UART_CLEAR_RTOF);
+
+		busy_ = true;
+		tx_done_ = rx_done_ = rx_ok_ = false;
+		rx_received_ = 0;
+		transfer_started_at_ = cycle_counter();
+		if (HAL_UART_Receive_DMA(huart_, rx_buf_, rx_chunk(t)) == HAL_OK) {
+			if (HAL_UART_Transmit_DMA(huart_, t.request, t.request_len)
+					== HAL_OK)
+				return;
+			HAL_UART_AbortReceive(huart_);
+		}
+
+		// The UART refused the transfer: fail this transaction rather than wedging the queue. Writes are counted
+		// all the same, for write verification to notice they never arrived.
+		count_writes(t);
+		if (t.reply_len != 0) {
+			++failed_reads_;
+		}
+		if (t.callback != nullptr) {
+			t.callback(t.context, false, 0);
+		}
+		++tail_;
+		busy_ = false;
+	}
+}
+
+size_t TMC2209Bus::rx_chunk(const Transaction &t) const {
+	return t.reply_len != 0 ?
+			t.request_len + t.reply_len : TMC_WRITE_DATAGRAM_SIZE;
+}
+
+void TMC2209Bus::try_complete(void) {
+	// The TX and RX completions come from different interrupts, and transactions may be queued from others still.
+	CriticalSection cs;
+	if (!busy_ || !tx_done_ || !rx_done_)
+		return;
+
+	const Transaction &t = queue_[tail_ % TMC_BUS_QUEUE_LENGTH];
+	// The reply, if any, comes right after the request's echo.
+	uint32_t data = 0;
+	bool ok = rx_ok_;
+	if (t.reply_len != 0) {
+		ok = ok
+				&& tmc_parse_reply(rx_buf_ + t.request_len, t.request[2],
+						data);
+		if (!ok) {
+			++failed_reads_;
+		}
+	}
+	count_writes(t);
+	if (t.callback != nullptr) {
+		t.callback(t.context, ok, data);
+	}
+
+	++tail_;
+	busy_ = false;
+	start_next();
+}
+
+void TMC2209Bus::count_writes(const Transaction &t) {
+	if (t.reply_len != 0)
+		return;
+	for (size_t offset = 0; offset < t.request_len; offset +=
+			TMC_WRITE_DATAGRAM_SIZE) {
+		++writes_sent_[t.request[offset + 1] % SERIAL_ADDRESS_COUNT];
+	}
+}
@@ -0,0 +1,76 @@
+#include "protocol.hpp"
+
+#include <array>
+#include <cstring>
+
+static constexpr std::array<uint16_t, 256> make_crc16_table() {
+	std::array<uint16_t, 256> table {};
+	for (uint16_t i = 0; i < 256; ++i) {
+		uint16_t crc = i << 8;
+		for (uint8_t bit = 0; bit < 8; ++bit) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+		table[i] = crc;
+	}
+	return table;
+}
+
+static constexpr auto CRC16_TABLE = make_crc16_table();
+
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc) {
+	for (size_t i = 0; i < len; ++i) {
+		crc = (crc << 8) ^ CRC16_TABLE[(crc >> 8) ^ data[i]];
+	}
+	return crc;
+}
+
+size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst) {
+	size_t code_idx = 0, out = 1;
+	uint8_t code = 1;
+	for (size_t i = 0; i < len; ++i) {
+		if (src[i] != FRAME_DELIMITER) {
+			dst[out++] = src[i];
+			++code;
+		}
+		if (src[i] == FRAME_DELIMITER || code == 0xFF) {
+			dst[code_idx] = code;
+			code_idx = out++;
+			code = 1;
+		}
+	}
+	dst[code_idx] = code;
+	dst[out++] = FRAME_DELIMITER;
+	return out;
+}
+
+size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst) {
+	size_t in = 0, out = 0;
+	while (in < len) {
+		const uint8_t code = src[in++];
+		if (code == FRAME_DELIMITER || in + code - 1 > len)
+			return 0;
+		for (uint8_t i = 1; i < code; ++i) {
+			dst[out++] = src[in++];
+		}
+		// A full block (0xFF) and the last block aren't followed by an implicit zero.
+		if (code != 0xFF && in < len) {
+			dst[out++] = FRAME_DELIMITER;
+		}
+	}
+	return out;
+}
+
+size_t frame_encode(uint8_t opcode, const uint8_t *payload, size_t len,
+		uint8_t *dst) {
+	if (len > MAX_FRAME_PAYLOAD)
+		return 0;
+
+	uint8_t frame[MAX_DECODED_FRAME_SIZE];
+	frame[0] = opcode;
+	std::memcpy(frame + 1, payload, len);
+	const uint16_t crc = crc16(frame, 1 + len);
+	frame[1 + len] = crc & 0xFF;
+	frame[2 + len] = crc >> 8;
+
+	return cobs_encode(frame, 1 + len + FRAME_CRC_SIZE, dst);
+}
@@ -1,109 +1,271 @@
 #include "robot.hpp"
 
+#include <cstring>
+
+#include "kinematics.hpp"
+#include "timebase.hpp"
+
+static_assert(2 + HostCommands::MAX_PAYLOAD_SIZE <= USB_RX_BUF_SIZE,
+		"The largest command must fit in the receive buffer");
+static_assert(HostCommands::MAX_PAYLOAD_SIZE <= MAX_FRAME_PAYLOAD,
+		"The largest command must fit in a COBS frame");
+static_assert(MAX_ENCODED_FRAME_SIZE <= USB_RX_BUF_SIZE,
+		"The largest COBS frame must fit in the receive buffer");
+static_assert(sizeof(WheelTelemetry) <= MAX_FRAME_PAYLOAD
+		&& 2 + sizeof(WheelTelemetry) <= TxQueue::FRAME_CAPACITY,
+		"Telemetry samples must fit in a single frame");
+static_assert(sizeof(StepperStatusReport) <= MAX_FRAME_PAYLOAD
+		&& 2 + sizeof(StepperStatusReport) <= TxQueue::FRAME_CAPACITY,
+		"Stepper status reports must fit in a single frame");
+
+// The wheel drivers' configuration, resolved to one write per register at compile time.
+static constexpr TMC2209::Config wheel_driver_config(void) {
+	TMC2209::Config config;
+	config.automatic_current_scaling = true;
+	config.run_current_percent = 100;
+	return config;
+}
+static constexpr TMC2209::RegisterImage WHEEL_DRIVER_IMAGE =
+		TMC2209::registerImage(wheel_driver_config());
 
 void Robot::init(UART_HandleTypeDef *tmc_uart, UART_HandleTypeDef *usb_uart,
-		I2C_HandleTypeDef *i2c) {
+		I2C_HandleTypeDef *i2c, TIM_HandleTypeDef *telemetry_tim,
+		TIM_HandleTypeDef *motion_tim, TIM_HandleTypeDef *step_tim,
+		TIM_HandleTypeDef *encoder_tim) {
 	tmc_uart_ = tmc_uart;
 	usb_uart_ = usb_uart;
 	i2c_ = i2c;
+	telemetry_tim_ = telemetry_tim;
+	motion_tim_ = motion_tim;
+	step_tim_ = step_tim;
+	encoder_tim_ = encoder_tim;
 
-	// Initialize stepper drivers.
-	stepper1_.setup(tmc_uart_, 115200, TMC2209::SERIAL_ADDRESS_0);
-	stepper1_.enableAutomaticCurrentScaling();
-	stepper1_.setRunCurrent(100);
-	stepper1_.enable();
-
-	stepper2_.setup(tmc_uart_, 115200, TMC2209::SERIAL_ADDRESS_1);
-	stepper2_.enableAutomaticCurrentScaling();
-	stepper2_.setRunCurrent(100);
-	stepper2_.enable();
+	// Initialize stepper drivers: each register goes to all three in one burst, and the bus sends them out in the
+	// background.
+	tmc_bus_.init(tmc_uart_);
+	stepper1_.attach(&tmc_bus_, 115200, TMC2209::SERIAL_ADDRESS_0);
+	stepper2_.attach(&tmc_bus_, 115200, TMC2209::SERIAL_ADDRESS_1);
+	stepper3_.attach(&tmc_bus_, 115200, TMC2209::SERIAL_ADDRESS_2);
+	TMC2209 *const steppers[WHEEL_COUNT] = { &stepper1_, &stepper2_, &stepper3_ };
+	if (!TMC2209::writeRegisterImage(steppers, WHEEL_COUNT, WHEEL_DRIVER_IMAGE,
+			on_drivers_configured, this)) {
+		boot_stats_.config_failed = 1;
+	}
+	if constexpr (TMC_BRINGUP_READBACK) {
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			if (!steppers[i]->verifyRegisterImage(WHEEL_DRIVER_IMAGE)) {
+				boot_stats_.readback_failed |= 1 << i;
+			}
+		}
+	}
 
-	stepper3_.setup(tmc_uart_, 115200, TMC2209::SERIAL_ADDRESS_2);
-	stepper3_.enableAutomaticCurrentScaling();
-	stepper3_.setRunCurrent(100);
-	stepper3_.enable();
+	step_generator_.init(step_tim_);
+	velocity_commit_.init(&tmc_bus_, steppers, &step_generator_,
+			&wheel_speeds_estimator_, motion_tim_);
+	velocity_commit_.set_ramp_limits( {
+			static_cast<float>(RAMP_MAX_ACCELERATION * RAD_PER_S_TO_VACTUAL),
+			static_cast<float>(RAMP_MAX_JERK * RAD_PER_S_TO_VACTUAL) });
+	velocity_commit_.set_speed_loop_gains( {
+			static_cast<float>(SPEED_LOOP_KP),
+			static_cast<float>(SPEED_LOOP_KI),
+			static_cast<float>(SPEED_LOOP_MAX_CORRECTION * RAD_PER_S_TO_VACTUAL) });
+	stepper_status_poller_.init(&tmc_bus_, steppers, &velocity_commit_);
 
 	// Initialize LCD screen.
 	lcd_.init(i2c_);
 	lcd_.put_cursor(0, 0);
 	lcd_.send_string("<3 from Mobius");
 
+	// Initialize wheel encoders, then sample them in the background. If they didn't come up, the speed loop stays
+	// open and 'a' reads zeros.
+	encoder_sampler_.init(&wheel_speeds_estimator_, &encoder_bus_,
+			encoder_tim_);
+	if (wheel_speeds_estimator_.init(i2c_, &encoder_bus_) == HAL_OK) {
+		encoder_sampler_.start(ENCODER_SAMPLE_RATE_HZ);
+	}
+
 	// TIM1 ARR sets the PWM frequency, empirically set to 20067 instead of the 19999 it should theoretically be for 50 Hz.
 	//TIM1->ARR = 20067;
 
-	// Start the UART RX interrupt cycle.
-	HAL_UART_Receive_IT(usb_uart_, &usb_rx_temp_, 1);
+	// Start the UART RX DMA cycle, and get ready to send responses.
+	usb_tx_queue_.init(usb_uart_);
+	start_usb_rx();
+	boot_stats_.ready_ms = HAL_GetTick();
+}
+
+// Called once per register of the image, as its burst completes.
+void Robot::on_drivers_configured(void *context, bool ok, uint32_t data) {
+	auto *self = static_cast<Robot*>(context);
+	if (!ok) {
+		self->boot_stats_.config_failed = 1;
+	}
+	if (++self->driver_config_bursts_ == TMC2209::REGISTER_IMAGE_SIZE
+			&& !self->boot_stats_.config_failed) {
+		self->boot_stats_.drivers_configured_ms = HAL_GetTick();
+	}
+}
+
+void Robot::start_usb_rx(void) {
+	// The DMA channel writes straight into the ring buffer's storage in circular mode, and the UART raises an
+	// event on idle line as well as on half/full transfer, so we only take an interrupt per burst instead of per byte.
+	HAL_UARTEx_ReceiveToIdle_DMA(usb_uart_, usb_rx_buf_.storage(),
+			USB_RX_BUF_SIZE);
+
+	// HAL aborts a DMA reception on any line error (noise, framing...), and restarting it would mean rewinding the
+	// consumer's side of the ring buffer from the ISR. A corrupted byte is better left to the protocol to reject.
+	CLEAR_BIT(usb_uart_->Instance->CR1, USART_CR1_PEIE);
+	CLEAR_BIT(usb_uart_->Instance->CR3, USART_CR3_EIE);
+}
+
+void Robot::send_response(uint8_t opcode, const void *data, size_t len) {
+	// Responses are only queued here, the DMA sends them out while we get on with the next command.
+	queue_frame(opcode, data, len, TxQueue::Kind::REPLY);
+}
+
+HAL_StatusTypeDef Robot::start_telemetry(uint16_t rate_hz) {
+	// Raw replies are only told apart by the request they answer, which unsolicited samples in the same stream would
+	// make ambiguous: streaming takes the COBS framing.
+	if constexpr (!HOST_PROTOCOL_COBS)
+		return HAL_ERROR;
+
+	if (rate_hz < TELEMETRY_MIN_RATE_HZ)
+		rate_hz = TELEMETRY_MIN_RATE_HZ;
+	if (rate_hz > TELEMETRY_MAX_RATE_HZ)
+		rate_hz = TELEMETRY_MAX_RATE_HZ;
+
+	// The timer counts at 100 kHz, so the update event fires at the requested rate without the main loop's help.
+	HAL_TIM_Base_Stop_IT(telemetry_tim_);
+	__HAL_TIM_SET_AUTORELOAD(telemetry_tim_, 100000 / rate_hz - 1);
+	__HAL_TIM_SET_COUNTER(telemetry_tim_, 0);
+	return HAL_TIM_Base_Start_IT(telemetry_tim_);
+}
+
+HAL_StatusTypeDef Robot::stop_telemetry(void) {
+	return HAL_TIM_Base_Stop_IT(telemetry_tim_);
+}
+
+void Robot::send_telemetry(void) {
+	WheelTelemetry sample { telemetry_seq_++, micros(),
+			usb_tx_queue_.dropped_telemetry(),
+			wheel_speeds_estimator_.get_wheel_info() };
+	velocity_commit_.get_tracking_errors(sample.tracking_error);
+	queue_frame('w', &sample, sizeof(sample), TxQueue::Kind::TELEMETRY);
+}
+
+void Robot::queue_frame(uint8_t opcode, const void *data, size_t len,
+		TxQueue::Kind kind) {
+	if constexpr (HOST_PROTOCOL_COBS) {
+		uint8_t frame[MAX_ENCODED_FRAME_SIZE];
+		const size_t frame_len = frame_encode(opcode,
+				static_cast<const uint8_t*>(data), len, frame);
+		usb_tx_queue_.send(frame, frame_len, kind);
+	} else {
+		usb_tx_queue_.send(static_cast<const uint8_t*>(data), len, kind);
+	}
+}
+
+void Robot::service_steppers(void) {
+	// Write verification is deferred, so that one IFCNT read covers every write of the last period rather than each
+	// command's.
+	const uint32_t now = HAL_GetTick();
+	if (now - last_write_verify_ms_ >= TMC_WRITE_VERIFY_PERIOD_MS) {
+		last_write_verify_ms_ = now;
+		stepper1_.verifyWrites();
+		stepper2_.verifyWrites();
+		stepper3_.verifyWrites();
+	}
+
+	stepper_status_poller_.poll();
 }
 
 void Robot::recv_command(void) {
+	if constexpr (HOST_PROTOCOL_COBS) {
+		recv_frame();
+	} else {
+		recv_legacy_command();
+	}
+}
+
+void Robot::recv_legacy_command(void) {
 	// Load header and opcode from the recv buffer, if available.
-	uint8_t header, opcode;
-	if (!usb_rx_buf_.peek_two(header, opcode)) {
+	const auto spans = usb_rx_buf_.peek_span(
+			2 + HostCommands::MAX_PAYLOAD_SIZE);
+	uint8_t frame[2];
+	if (!spans.copy(frame, 2)) {
 		__WFI(); // If we haven't got two bytes available, go into sleep mode until the next interrupt.
 		return;
 	}
+	const uint8_t header = frame[0], opcode = frame[1];
 
 	// Check the header: if it isn't correct, we should discard it and move on, perhaps there's been some sort of noise.
 	if (header != 'M') {
-		usb_rx_buf_.discard();
+		usb_rx_buf_.commit(spans, 1);
 		return;
 	}
 
-	// Based on the opcode, choose the correct command type.
-	// NB: Those without a payload need to manually handle discarding their header and opcode.
-	switch (opcode) {
-	case 's': {  // Set servo CCRs.
-		recv_payload_and_execute<SetServoCommand>();
-		break;
-	}
-	case 'a': {  // Read wheel info.
-		ReadWheelInfoCommand cmd;
-		cmd.execute();
-		usb_rx_buf_.discard(2);
-		break;
-	}
-	case 'u': {  // Set wheel speeds.
-		recv_payload_and_execute<SetWheelSpeedsCommand>();
-		break;
-	}
-	case 'x': {  // Stop all steppers.
-		StopSteppersCommand cmd;
-		cmd.execute();
-		usb_rx_buf_.discard(2);
-		break;
-	}
-	case 'p': {  // Reply pong.
-		PongCommand cmd;
-		cmd.execute();
-		usb_rx_buf_.discard(2);
-		break;
-	}
-	case 'k': {  // Set wheel velocities via inverse kinematics.
-		recv_payload_and_execute<InverseKinematicsCommand>();
-		break;
-	}
-	case 'l': { // Print to LCD.
-		recv_payload_and_execute<LcdPrintCommand>();
-		break;
+	// Look the opcode up, and wait for its whole payload before executing it.
+	const auto &cmd = HostCommands::lookup(opcode);
+	if (cmd.decode_and_execute == nullptr) {
+		usb_rx_buf_.commit(spans, 2);
+		return;
 	}
-	default:
-		usb_rx_buf_.discard(2);
-		break;
+	uint8_t payload[HostCommands::MAX_PAYLOAD_SIZE];
+	if (!spans.copy(payload, cmd.payload_size, 2)) {
+		__WFI();
+		return;
 	}
+	usb_rx_buf_.commit(spans, 2 + cmd.payload_size);
+
+	// Bombs away!
+	cmd.decode_and_execute(payload);
 }
 
-template<typename T> void Robot::recv_payload_and_execute(void) {
-	// Check if we've got enough data to load the command.
-	T cmd;
-	if (usb_rx_buf_.available() < (2+sizeof(T))) return;
+void Robot::recv_frame(void) {
+	// Look for the delimiter ending the next frame.
+	const auto spans = usb_rx_buf_.peek_span(MAX_ENCODED_FRAME_SIZE);
+	size_t frame_len;
+	auto end = static_cast<const uint8_t*>(std::memchr(spans.first.data,
+			FRAME_DELIMITER, spans.first.size));
+	if (end != nullptr) {
+		frame_len = end - spans.first.data;
+	} else if ((end = static_cast<const uint8_t*>(std::memchr(
+			spans.second.data, FRAME_DELIMITER, spans.second.size)))) {
+		frame_len = spans.first.size + (end - spans.second.data);
+	} else {
+		if (spans.size() == MAX_ENCODED_FRAME_SIZE) {
+			// No frame can be this long: it's noise, or we've started listening mid-frame. Throw it all away.
+			usb_rx_buf_.commit(spans, spans.size());
+			++usb_rx_bad_frames_;
+		} else {
+			__WFI(); // The frame isn't complete yet, go into sleep mode until the next interrupt.
+		}
+		return;
+	}
+
+	// Take the whole frame and its delimiter out of the buffer in one go: if it turns out to be corrupted, we're
+	// already resynchronised on the next one.
+	uint8_t frame[MAX_ENCODED_FRAME_SIZE];
+	spans.copy(frame, frame_len);
+	usb_rx_buf_.commit(spans, frame_len + 1);
+	if (frame_len == 0)
+		return; // Back-to-back delimiters, used by the host to flush a partial frame.
 
-	// If so, discard header & opcode and start copying from the buffer into the command instance.
-	usb_rx_buf_.discard(2);
-	auto ptr = reinterpret_cast<uint8_t*>(&cmd);
-	for (size_t i = 0; i < sizeof(T); ++i) {
-		usb_rx_buf_.pop(ptr[i]);
+	const size_t len = cobs_decode(frame, frame_len, frame);
+	if (len < 1 + FRAME_CRC_SIZE) {
+		++usb_rx_bad_frames_;
+		return;
+	}
+	const uint16_t crc = frame[len - 2] | (frame[len - 1] << 8);
+	if (crc16(frame, len - FRAME_CRC_SIZE) != crc) {
+		++usb_rx_bad_frames_;
+		return;
 	}
 
-	// Bombs away!
-	cmd.execute();
+	const auto &cmd = HostCommands::lookup(frame[0]);
+	if (cmd.decode_and_execute == nullptr
+			|| cmd.payload_size != len - 1 - FRAME_CRC_SIZE) {
+		++usb_rx_bad_frames_;
+		return;
+	}
+	cmd.decode_and_execute(frame + 1);
 }
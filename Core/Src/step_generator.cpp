@@ -0,0 +1,122 @@
+#include "step_generator.hpp"
+
+#include <cmath>
+
+#include "critical_section.hpp"
+#include "main.h"
+
+// A compare point set closer than this to the counter could be passed before it is written, and only come round
+// again when the counter wraps.
+constexpr uint32_t MIN_COMPARE_LEAD = 64;
+// DIR level for positive steps, the same way round as a positive VACTUAL.
+constexpr GPIO_PinState DIR_FORWARD = GPIO_PIN_SET;
+constexpr GPIO_PinState DIR_REVERSE = GPIO_PIN_RESET;
+
+static GPIO_TypeDef *const DIR_PORTS[WHEEL_COUNT] = { DIR1_GPIO_Port,
+		DIR2_GPIO_Port, DIR3_GPIO_Port };
+static const uint16_t DIR_PINS[WHEEL_COUNT] = { DIR1_Pin, DIR2_Pin, DIR3_Pin };
+
+void StepGenerator::init(TIM_HandleTypeDef *tim) {
+	tim_ = tim;
+	ticks_per_s_ = SystemCoreClock / (tim_->Init.Prescaler + 1);
+
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		set_output_mode(i, TIM_OCMODE_FORCED_INACTIVE);
+		HAL_GPIO_WritePin(DIR_PORTS[i], DIR_PINS[i], DIR_REVERSE);
+	}
+	HAL_TIM_OC_Start(tim_, TIM_CHANNEL_1);
+	HAL_TIM_OC_Start(tim_, TIM_CHANNEL_2);
+	HAL_TIM_OC_Start(tim_, TIM_CHANNEL_3);
+}
+
+void StepGenerator::set_rate(uint8_t wheel, float steps_per_s) {
+	const float rate = std::fmin(std::fabs(steps_per_s), STEP_MAX_RATE_HZ);
+	// Half periods are compared as signed, anything longer is as good as stopped.
+	const float half_period_ticks = ticks_per_s_ / (2 * rate);
+	const uint32_t half_period =
+			half_period_ticks < INT32_MAX ?
+					static_cast<uint32_t>(half_period_ticks) : 0;
+
+	Channel &channel = channels_[wheel];
+	CriticalSection cs;
+	const bool forward = steps_per_s > 0;
+	if (half_period != 0 && forward != channel.forward) {
+		// The driver takes DIR on STEP's rising edge, and so does the step count.
+		HAL_GPIO_WritePin(DIR_PORTS[wheel], DIR_PINS[wheel],
+				forward ? DIR_FORWARD : DIR_REVERSE);
+		channel.forward = forward;
+	}
+	channel.half_period = half_period;
+
+	if (half_period == 0)
+		return; // The interrupt stops the channel after its next falling edge.
+	if (!channel.running) {
+		start(wheel);
+	} else if (static_cast<int32_t>(compare(wheel) - __HAL_TIM_GET_COUNTER(tim_))
+			> static_cast<int32_t>(half_period)) {
+		// Don't sit out the rest of a long period at the old rate.
+		compare(wheel) = __HAL_TIM_GET_COUNTER(tim_) + MIN_COMPARE_LEAD;
+	}
+}
+
+void StepGenerator::on_compare(uint8_t wheel) {
+	Channel &channel = channels_[wheel];
+	channel.high = !channel.high;
+	if (channel.high) {
+		channel.position += channel.forward ? 1 : -1;
+	} else if (channel.half_period == 0) {
+		stop(wheel);
+		return;
+	}
+
+	uint32_t next = compare(wheel) + channel.half_period;
+	const uint32_t now = __HAL_TIM_GET_COUNTER(tim_);
+	if (static_cast<int32_t>(next - now) < static_cast<int32_t>(MIN_COMPARE_LEAD)) {
+		next = now + MIN_COMPARE_LEAD;
+	}
+	compare(wheel) = next;
+}
+
+void StepGenerator::get_positions(int32_t *steps) {
+	CriticalSection cs;
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		steps[i] = channels_[i].position;
+	}
+}
+
+void StepGenerator::start(uint8_t wheel) {
+	Channel &channel = channels_[wheel];
+	channel.running = true;
+	channel.high = false;
+	compare(wheel) = __HAL_TIM_GET_COUNTER(tim_) + MIN_COMPARE_LEAD;
+	set_output_mode(wheel, TIM_OCMODE_TOGGLE);
+	__HAL_TIM_CLEAR_IT(tim_, TIM_IT_CC1 << wheel);
+	__HAL_TIM_ENABLE_IT(tim_, TIM_IT_CC1 << wheel);
+}
+
+void StepGenerator::stop(uint8_t wheel) {
+	// Forced inactive, or the pin would keep toggling every time the counter wraps round to the compare point.
+	__HAL_TIM_DISABLE_IT(tim_, TIM_IT_CC1 << wheel);
+	set_output_mode(wheel, TIM_OCMODE_FORCED_INACTIVE);
+	channels_[wheel].running = false;
+}
+
+void StepGenerator::set_output_mode(uint8_t wheel, uint32_t mode) {
+	// Channels 1 and 2 share CCMR1, 3 is in CCMR2: read-modify-write, safe here as the channels' interrupts and
+	// set_rate() never preempt each other.
+	switch (wheel) {
+	case 0:
+		MODIFY_REG(tim_->Instance->CCMR1, TIM_CCMR1_OC1M, mode);
+		break;
+	case 1:
+		MODIFY_REG(tim_->Instance->CCMR1, TIM_CCMR1_OC2M, mode << 8);
+		break;
+	case 2:
+		MODIFY_REG(tim_->Instance->CCMR2, TIM_CCMR2_OC3M, mode);
+		break;
+	}
+}
+
+volatile uint32_t& StepGenerator::compare(uint8_t wheel) {
+	return (&tim_->Instance->CCR1)[wheel];
+}
@@ -0,0 +1,62 @@
+#include "stepper_status_poller.hpp"
+
+#include "critical_section.hpp"
+
+void StepperStatusPoller::init(TMC2209Bus *bus, TMC2209 *const *steppers,
+		const VelocityCommit *velocity_commit) {
+	bus_ = bus;
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		steppers_[i] = steppers[i];
+	}
+	velocity_commit_ = velocity_commit;
+}
+
+void StepperStatusPoller::poll(void) {
+	if (in_flight_ || !bus_->idle())
+		return;
+	// A read started now would still be on the wire when the velocity commit comes.
+	if (velocity_commit_->us_until_tick() < bus_->read_time_us())
+		return;
+
+	in_flight_ = true;
+	if (!steppers_[next_wheel_]->readAsync(REGISTERS[next_register_],
+			on_reply, this)) {
+		in_flight_ = false;
+	}
+}
+
+void StepperStatusPoller::on_reply(void *context, bool ok, uint32_t data) {
+	auto *self = static_cast<StepperStatusPoller*>(context);
+	if (ok) {
+		self->readings_[self->next_wheel_][self->next_register_] = { data,
+				HAL_GetTick() };
+	}
+
+	// A failed read moves on all the same, its reading just gets older.
+	if (++self->next_register_ == REGISTER_COUNT) {
+		self->next_register_ = 0;
+		self->next_wheel_ = (self->next_wheel_ + 1) % WHEEL_COUNT;
+	}
+	self->in_flight_ = false;
+}
+
+StepperStatusReport StepperStatusPoller::get_report(void) {
+	StepperStatusReport report;
+	CriticalSection cs;
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		const Reading *readings = readings_[i];
+		StepperStatus &status = report.steppers[i];
+		status.drv_status = readings[0].value;
+		status.sg_result = readings[1].value;
+		status.tstep = readings[2].value;
+		status.pwm_scale = readings[3].value;
+
+		status.timestamp_ms = readings[0].timestamp_ms;
+		for (uint8_t r = 1; r < REGISTER_COUNT; ++r) {
+			if (readings[r].timestamp_ms < status.timestamp_ms) {
+				status.timestamp_ms = readings[r].timestamp_ms;
+			}
+		}
+	}
+	return report;
+}
@@ -24,6 +24,20 @@
 #include <errno.h>
 #include <stdint.h>
 
+#ifdef NO_HEAP
+/**
+ * @brief With NO_HEAP defined, nothing may allocate from the heap. malloc and
+ *        the rest of the C library's allocator come with _sbrk, which then
+ *        calls a function that is defined nowhere: a build that pulls them in
+ *        fails to link on it. The linker map tells what pulled them in.
+ */
+extern void *heap_allocation_with_NO_HEAP_defined(ptrdiff_t incr);
+
+void *_sbrk(ptrdiff_t incr)
+{
+  return heap_allocation_with_NO_HEAP_defined(incr);
+}
+#else
 /**
  * Pointer to the current high watermark of the heap usage
  */
@@ -77,3 +91,4 @@ void *_sbrk(ptrdiff_t incr)
 
   return (void *)prev_heap_end;
 }
+#endif /* NO_HEAP */
@@ -0,0 +1,28 @@
+#include "timebase.hpp"
+
+#include "critical_section.hpp"
+#include "cycle_counter.hpp"
+
+// The clock is base_us plus the whole microseconds counted since base_cycles. Rebasing often keeps that count short
+// of the cycle counter's wrap (67 s at 64 MHz), and carries the leftover cycles over so no time is lost.
+static uint32_t base_cycles = 0;
+static uint32_t base_us = 0;
+
+void timebase_init(void) {
+	cycle_counter_init();
+	CriticalSection cs;
+	base_cycles = cycle_counter();
+	base_us = 0;
+}
+
+uint32_t micros(void) {
+	CriticalSection cs;
+	return base_us + cycles_to_us(cycle_counter() - base_cycles);
+}
+
+extern "C" void timebase_tick(void) {
+	CriticalSection cs;
+	const uint32_t us = cycles_to_us(cycle_counter() - base_cycles);
+	base_us += us;
+	base_cycles += us * (SystemCoreClock / 1000000);
+}
@@ -0,0 +1,106 @@
+#include "tx_queue.hpp"
+
+#include <cstring>
+
+#include "critical_section.hpp"
+
+void TxQueue::init(UART_HandleTypeDef *huart) {
+	huart_ = huart;
+}
+
+bool TxQueue::send(const uint8_t *data, size_t len, Kind kind) {
+	if (len == 0 || len > FRAME_CAPACITY)
+		return false;
+
+	while (true) {
+		{
+			CriticalSection cs;
+			Slot *slot = claim_slot();
+			if (slot != nullptr) {
+				std::memcpy(slot->data, data, len);
+				slot->len = len;
+				slot->kind = kind;
+				slot->seq = next_seq_++;
+				slot->state = State::QUEUED;
+				if (!sending_) {
+					start_next();
+				}
+				return true;
+			}
+			if (kind == Kind::TELEMETRY) {
+				++dropped_telemetry_;
+				return false;
+			}
+			if (!sending_) {
+				start_next(); // Nothing in flight to free a slot: the UART refused the last transfer, try it again.
+			}
+		}
+		// Only replies get here, with the queue full of replies: wait for the transfer in flight to complete.
+		__WFI();
+	}
+}
+
+void TxQueue::on_tx_complete(void) {
+	CriticalSection cs;
+	for (auto &slot : slots_) {
+		if (slot.state == State::SENDING) {
+			slot.state = State::FREE;
+		}
+	}
+	sending_ = false;
+	start_next();
+}
+
+void TxQueue::poll(void) {
+	CriticalSection cs;
+	if (!sending_) {
+		start_next();
+	}
+}
+
+TxQueue::Slot* TxQueue::claim_slot(void) {
+	Slot *oldest_telemetry = nullptr;
+	for (auto &slot : slots_) {
+		if (slot.state == State::FREE)
+			return &slot;
+		if (slot.state == State::QUEUED && slot.kind == Kind::TELEMETRY
+				&& (oldest_telemetry == nullptr
+						|| int32_t(slot.seq - oldest_telemetry->seq) < 0)) {
+			oldest_telemetry = &slot;
+		}
+	}
+
+	// Full: make room for a frame by evicting the oldest telemetry that hasn't started sending yet.
+	if (oldest_telemetry != nullptr) {
+		++dropped_telemetry_;
+		oldest_telemetry->state = State::FREE;
+	}
+	return oldest_telemetry;
+}
+
+void TxQueue::start_next(void) {
+	Slot *next = nullptr;
+	for (auto &slot : slots_) {
+		if (slot.state == State::QUEUED
+				&& (next == nullptr || int32_t(slot.seq - next->seq) < 0)) {
+			next = &slot;
+		}
+	}
+	if (next == nullptr)
+		return;
+
+	next->state = State::SENDING;
+	sending_ = true;
+	if (HAL_UART_Transmit_DMA(huart_, next->data, next->len) != HAL_OK) {
+		// The UART refused the transfer: a reply stays queued for the next poll() or completion to try again, telemetry
+		// is dropped rather than held up for.
+		++failed_transfers_;
+		sending_ = false;
+		if (next->kind == Kind::TELEMETRY) {
+			++dropped_telemetry_;
+			next->state = State::FREE;
+		} else {
+			next->state = State::QUEUED;
+		}
+	}
+}
@@ -0,0 +1,192 @@
+#include "velocity_commit.hpp"
+
+#include "critical_section.hpp"
+#include "cycle_counter.hpp"
+#include "kinematics.hpp"
+
+// Measured wheel speeds to the VACTUAL units the loops run in.
+constexpr float VACTUAL_PER_MEASURED = static_cast<float>(WHEEL_ENCODER_SIGN
+		* RAD_PER_S_TO_VACTUAL);
+
+void VelocityCommit::init(TMC2209Bus *bus, TMC2209 *const *steppers,
+		StepGenerator *step_generator, WheelSpeedsEstimator *estimator,
+		TIM_HandleTypeDef *tim) {
+	bus_ = bus;
+	step_generator_ = step_generator;
+	estimator_ = estimator;
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		steppers_[i] = steppers[i];
+		steppers_[i]->delegateVelocity(on_lost_write, this);
+	}
+	tim_ = tim;
+	// The timer counts in µs.
+	tick_period_s_ = (__HAL_TIM_GET_AUTORELOAD(tim_) + 1) * 1e-6f;
+
+	cycle_counter_init();
+	HAL_TIM_Base_Start_IT(tim_);
+}
+
+void VelocityCommit::set_targets(const int32_t *vactual) {
+	// All together, or a tick could ramp some wheels to the new twist and others to the old one.
+	CriticalSection cs;
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		targets_[i] = vactual[i];
+	}
+}
+
+void VelocityCommit::set_backend(MotionBackend backend) {
+	// Picked up on the next tick, which hands the wheels' velocities over to the new backend.
+	CriticalSection cs;
+	backend_ = backend;
+}
+
+void VelocityCommit::set_ramp_limits(const RampLimits &limits) {
+	CriticalSection cs;
+	limits_ = limits;
+}
+
+void VelocityCommit::set_speed_loop_gains(const SpeedLoopGains &gains) {
+	CriticalSection cs;
+	gains_ = gains;
+}
+
+void VelocityCommit::stop_now(void) {
+	uint32_t data[WHEEL_COUNT] { };
+	uint8_t wheels[WHEEL_COUNT];
+	{
+		CriticalSection cs;
+		const float commanded[WHEEL_COUNT] { };
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			targets_[i] = 0;
+			ramps_[i].reset();
+			speed_loops_[i].reset();
+			step_generator_->set_rate(i, 0);
+			resend_[i] = true;
+			wheels[i] = i;
+		}
+		estimator_->set_commanded_speeds(commanded);
+		// With a burst in flight, the next tick sends the stop as soon as it's done.
+		if (in_flight_)
+			return;
+		in_flight_ = true;
+	}
+	// Outside the critical section: from thread mode, the bus can wait for room in its queue.
+	send_burst(wheels, data, WHEEL_COUNT);
+}
+
+void VelocityCommit::on_tick(void) {
+	uint32_t data[WHEEL_COUNT];
+	uint8_t wheels[WHEEL_COUNT];
+	uint8_t count = 0;
+	const bool step_dir = backend_ == MotionBackend::STEP_DIR;
+	float measured[WHEEL_COUNT];
+	const bool closed_loop = gains_.max_correction > 0
+			&& estimator_->get_speeds(measured, SPEED_LOOP_STALE_MS);
+	float commanded[WHEEL_COUNT];
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		// The ramps keep time even while a burst is in flight, only sending waits.
+		const float reference = ramps_[i].step(targets_[i], limits_,
+				tick_period_s_);
+		// A wheel told to stand still does, rather than hunting around 0 on encoder noise.
+		float velocity = reference;
+		if (closed_loop && (targets_[i] != 0 || reference != 0)) {
+			velocity = speed_loops_[i].step(reference,
+					measured[i] * VACTUAL_PER_MEASURED, gains_, tick_period_s_);
+		} else {
+			speed_loops_[i].reset();
+		}
+		commanded[i] = velocity / VACTUAL_PER_MEASURED;
+		step_generator_->set_rate(i,
+				step_dir ? velocity * static_cast<float>(VACTUAL_STEP_RATE) : 0);
+		const int32_t vactual = step_dir ? 0 : static_cast<int32_t>(velocity);
+		if (vactual != sent_[i] || resend_[i]) {
+			data[count] = vactual;
+			wheels[count] = i;
+			++count;
+		}
+	}
+
+	estimator_->set_commanded_speeds(commanded);
+
+	// One burst at a time, so that it can be timed: anything changed meanwhile goes on the next tick.
+	if (count == 0 || in_flight_)
+		return;
+
+	in_flight_ = true;
+	send_burst(wheels, data, count);
+}
+
+void VelocityCommit::send_burst(const uint8_t *wheels, const uint32_t *data,
+		uint8_t count) {
+	uint8_t addresses[WHEEL_COUNT];
+	tick_at_ = cycle_counter();
+	burst_size_ = count;
+	// Taken as sent from here, so that the next ticks don't send the same again while this burst is in flight. If it
+	// fails, the completion has its wheels resent.
+	for (uint8_t i = 0; i < count; ++i) {
+		addresses[i] = steppers_[wheels[i]]->getSerialAddress();
+		burst_wheels_[i] = wheels[i];
+		sent_[wheels[i]] = data[i];
+		resend_[wheels[i]] = false;
+	}
+	if (!bus_->write_burst(addresses, TMC2209::ADDRESS_VACTUAL, data, count,
+			on_burst_complete, this)) {
+		// The bus queue is full, try again on the next tick.
+		in_flight_ = false;
+		for (uint8_t i = 0; i < count; ++i) {
+			resend_[wheels[i]] = true;
+		}
+	}
+}
+
+void VelocityCommit::on_burst_complete(void *context, bool ok,
+		uint32_t data) {
+	auto *self = static_cast<VelocityCommit*>(context);
+	self->in_flight_ = false;
+	if (!ok) {
+		// Some of the drivers may not have their new VACTUAL: send it to all of them again on the next tick.
+		for (uint8_t i = 0; i < self->burst_size_; ++i) {
+			self->resend_[self->burst_wheels_[i]] = true;
+		}
+		return;
+	}
+
+	// Each driver has its datagram once the last byte of it is back on the echo.
+	const uint32_t first = self->bus_->datagram_done_at(0);
+	const uint32_t last = self->bus_->datagram_done_at(self->burst_size_ - 1);
+	const uint32_t skew = cycles_to_us(last - first);
+	const uint32_t latency = cycles_to_us(last - self->tick_at_);
+
+	auto &stats = self->stats_;
+	++stats.commits;
+	stats.last_skew_us = skew;
+	stats.last_latency_us = latency;
+	if (skew > stats.max_skew_us) {
+		stats.max_skew_us = skew;
+	}
+	if (latency > stats.max_latency_us) {
+		stats.max_latency_us = latency;
+	}
+}
+
+VelocityCommitStats VelocityCommit::get_stats(void) {
+	CriticalSection cs;
+	return stats_;
+}
+
+void VelocityCommit::get_tracking_errors(float *errors) {
+	CriticalSection cs;
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		errors[i] = speed_loops_[i].error()
+				/ static_cast<float>(RAD_PER_S_TO_VACTUAL);
+	}
+}
+
+void VelocityCommit::on_lost_write(void *context, uint8_t serial_address) {
+	auto *self = static_cast<VelocityCommit*>(context);
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		if (self->steppers_[i]->getSerialAddress() == serial_address) {
+			self->resend_[i] = true;
+		}
+	}
+}
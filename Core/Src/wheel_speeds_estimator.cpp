@@ -3,6 +3,8 @@
 #include "stm32h5xx_nucleo.h"
 
 #include "main.h"
+#include "critical_section.hpp"
+#include "timebase.hpp"
 
 #define CHECK_HAL_STATUS(func_call)           \
     do {                                      \
@@ -11,37 +13,27 @@
             return status;                    \
     } while (0)
 
-HAL_StatusTypeDef WheelSpeedsEstimator::init(I2C_HandleTypeDef *hi2c) {
+HAL_StatusTypeDef WheelSpeedsEstimator::init(I2C_HandleTypeDef *hi2c,
+		AS5600Bus *bus) {
 	i2c_ = hi2c;
+	bus_ = bus;
 
-	as5600_ = AS5600_New();
-	if (as5600_ == NULL)
-		return HAL_ERROR;
-	as5600_->i2cHandle = i2c_;
-	as5600_->i2cAddr = (0x36 << 1); // AS5600 I2C address shifted for STM32 HAL
-
-	for (uint8_t channel = 0; channel < WHEEL_COUNT; ++channel) {
-		CHECK_HAL_STATUS(set_channel(2 + channel));
-		CHECK_HAL_STATUS(AS5600_Init(as5600_));
+	for (uint8_t wheel = 0; wheel < WHEEL_COUNT; ++wheel) {
+		AS5600_Construct(&as5600_[wheel], i2c_, AS5600_ADDR);
+		CHECK_HAL_STATUS(set_channel(encoder_mux_channel(wheel)));
+		CHECK_HAL_STATUS(AS5600_Init(&as5600_[wheel]));
 	}
+	bus_->init(i2c_, on_sample, this);
 
 	initialized_ = true;
 	return HAL_OK;
 }
 
-HAL_StatusTypeDef WheelSpeedsEstimator::read_sensors(uint16_t *buf) {
-	for (uint8_t channel = 0; channel < WHEEL_COUNT; ++channel) {
-		CHECK_HAL_STATUS(set_channel(2 + channel));
-		CHECK_HAL_STATUS(AS5600_GetAngle(as5600_, buf + channel));
-	}
-	return HAL_OK;
-}
-
 HAL_StatusTypeDef WheelSpeedsEstimator::set_channel(uint8_t channel) {
 	if (channel > 7)
 		return HAL_ERROR;  // Invalid channel number
 
-	uint8_t cmd = (1 << channel) | 0b01100000;
+	uint8_t cmd = tca9548a_select(channel);
 	auto status = HAL_I2C_Master_Transmit(i2c_, TCA9548A_ADDR, &cmd, 1,
 	1000);
 	return status;
@@ -52,35 +44,113 @@ inline int32_t positive_mod(int32_t a, int32_t n) {
 }
 
 HAL_StatusTypeDef WheelSpeedsEstimator::update(void) {
-	if (!initialized_) return HAL_OK;
-	uint32_t current_time = HAL_GetTick();
-	if (prev_time_ != 0) {
-		uint16_t counts[WHEEL_COUNT];
-		CHECK_HAL_STATUS(read_sensors(counts));
-
-		wheel1_.update(counts[0], current_time);
-		wheel2_.update(counts[1], current_time);
-		wheel3_.update(counts[2], current_time);
-//
-//		double x_dot = -WHEEL_RADIUS / 3 * (-2 * u1 + u2 + u3);
-//		double y_dot = -SQRT_3 * WHEEL_RADIUS / 3 * (u2 - u3);
-//		double psi_dot = -WHEEL_RADIUS / (3 * WHEEL_BASE) * (u1 + u2 + u3);
-//
-//		double delta_time = (current_time - prev_time_) / 1000.0;
-//		if (delta_time > 0) {
-//			x_ += x_dot * delta_time;
-//			y_ += y_dot * delta_time;
-//			psi_ += psi_dot * delta_time;
-//		}
+	if (!initialized_) return HAL_ERROR;
+	return bus_->start() ? HAL_OK : HAL_BUSY;
+}
+
+void WheelSpeedsEstimator::on_sample(void *context, bool ok,
+		const EncoderSample &sample) {
+	WheelSpeedsEstimator *self = static_cast<WheelSpeedsEstimator*>(context);
+	if (!ok)
+		return;
+
+	// Each wheel goes by the time of its own read, they are about 0.7 ms apart.
+	self->wheels_.update(sample.counts, sample.timestamps_us,
+			self->use_command_ ? self->commanded_ : nullptr);
+	const uint32_t sampled_at = sample.timestamps_us[WHEEL_COUNT - 1];
+	if (self->sampled_
+			&& us_between(self->last_sampled_at_, sampled_at)
+					> ENCODER_MAX_SAMPLE_GAP_US) {
+		// Failed acquisitions or a stall in between: there's no telling how many turns went by.
+		self->sampled_ = false;
+		++self->ticks_.discontinuities;
 	}
-	prev_time_ = current_time;
+	if (self->sampled_) {
+		// Less than half a turn between samples, so the shortest way round is the way the wheel went.
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			self->ticks_.ticks[i] += positive_mod(
+					sample.counts[i] - self->last_counts_[i]
+							+ ENCODER_FULL_RANGE / 2, ENCODER_FULL_RANGE)
+					- ENCODER_FULL_RANGE / 2;
+		}
+		self->ticks_.timestamp_us = sampled_at;
 
-	return HAL_OK;
+		// From the second sample on, the wheels have a speed.
+		self->updated_at_ = sampled_at;
+		self->has_speeds_ = true;
+	}
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		self->last_counts_[i] = sample.counts[i];
+	}
+	self->last_sampled_at_ = sampled_at;
+	self->sampled_ = true;
+
+	// The wheels' speeds as the kinematics count them, taken to be at the middle of the acquisition.
+	float speeds[WHEEL_COUNT];
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		speeds[i] = self->wheels_.speed(i)
+				* static_cast<float>(WHEEL_ENCODER_SIGN);
+	}
+	self->odometry_.update(speeds,
+			us_midpoint(sample.timestamps_us[0],
+					sample.timestamps_us[WHEEL_COUNT - 1]));
 }
 
 WheelInfo WheelSpeedsEstimator::get_wheel_info(void) {
+	CriticalSection cs; // Against a sample coming in halfway.
 	return {
-		wheel1_.get_position(), wheel2_.get_position(), wheel3_.get_position(),
-		wheel1_.get_speed(), wheel2_.get_speed(), wheel3_.get_speed()
+		wheels_.angle(0), wheels_.angle(1), wheels_.angle(2),
+		wheels_.speed(0), wheels_.speed(1), wheels_.speed(2)
 	};
 }
+
+bool WheelSpeedsEstimator::get_speeds(float *speeds, uint32_t max_age_ms) {
+	CriticalSection cs;
+	if (!has_speeds_ || us_between(updated_at_, micros()) > max_age_ms * 1000)
+		return false;
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		speeds[i] = wheels_.speed(i);
+	}
+	return true;
+}
+
+WheelTicks WheelSpeedsEstimator::latch_ticks(bool reset) {
+	CriticalSection cs;
+	const WheelTicks ticks = ticks_;
+	if (reset) {
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			ticks_.ticks[i] = 0;
+		}
+	}
+	return ticks;
+}
+
+void WheelSpeedsEstimator::on_sampling_stopped(void) {
+	CriticalSection cs;
+	if (sampled_) {
+		sampled_ = false;
+		++ticks_.discontinuities;
+	}
+}
+
+OdometryState WheelSpeedsEstimator::get_odometry(bool reset) {
+	CriticalSection cs;
+	const OdometryState state = odometry_.get_state();
+	if (reset) {
+		odometry_.reset();
+	}
+	return state;
+}
+
+void WheelSpeedsEstimator::set_commanded_speeds(const float *speeds) {
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		commanded_[i] = speeds[i];
+	}
+}
+
+void WheelSpeedsEstimator::set_noise(const WheelNoise &noise,
+		bool use_command) {
+	CriticalSection cs;
+	wheels_.set_noise(noise);
+	use_command_ = use_command;
+}
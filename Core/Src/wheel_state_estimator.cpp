@@ -0,0 +1,83 @@
+#include "wheel_state_estimator.hpp"
+
+#include "timebase.hpp"
+
+constexpr float TAU_F = static_cast<float>(TAU);
+constexpr float PI_F = static_cast<float>(TAU / 2);
+constexpr float RAD_PER_COUNT = static_cast<float>(TAU / ENCODER_FULL_RANGE);
+// Speed variance to start from when the speed isn't known yet: (10 rad/s)^2.
+constexpr float INITIAL_SPEED_VARIANCE = 100;
+// Past this, the wheel starts over from its measurement.
+constexpr float MAX_SAMPLE_INTERVAL_S = ENCODER_MAX_SAMPLE_GAP_US * 1e-6f;
+
+// The angles wrapped below are less than a turn outside the range, so one step brings them in.
+// Into [-π, π).
+static inline float wrap_signed(float a) {
+	if (a >= PI_F) {
+		a -= TAU_F;
+	} else if (a < -PI_F) {
+		a += TAU_F;
+	}
+	return a;
+}
+// Into [0, 2π).
+static inline float wrap_positive(float a) {
+	if (a >= TAU_F) {
+		a -= TAU_F;
+	} else if (a < 0) {
+		a += TAU_F;
+	}
+	return a;
+}
+
+void WheelStateEstimator::update(const uint16_t *counts,
+		const uint32_t *timestamps_us, const float *commanded) {
+	const float q = noise_.acceleration;
+	const float r = noise_.measurement;
+
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		const float command = commanded != nullptr ? commanded[i] : 0;
+		const float dt = us_between(time_[i], timestamps_us[i]) * 1e-6f;
+		if (!started_ || dt > MAX_SAMPLE_INTERVAL_S) {
+			start(i, counts[i], timestamps_us[i], command);
+			continue;
+		}
+		if (dt <= 0)
+			continue; // Nothing new for this wheel.
+		time_[i] = timestamps_us[i];
+
+		// Predict, with the commanded speed change as the acceleration over the interval.
+		const float dv = commanded != nullptr ? command - commanded_[i] : 0;
+		commanded_[i] = command;
+		const float angle = angle_[i] + (speed_[i] + 0.5f * dv) * dt;
+		const float speed = speed_[i] + dv;
+		const float dt2 = dt * dt;
+		const float p00 = p00_[i] + dt * (2 * p01_[i] + dt * p11_[i])
+				+ q * dt2 * dt / 3;
+		const float p01 = p01_[i] + dt * p11_[i] + q * dt2 / 2;
+		const float p11 = p11_[i] + q * dt;
+
+		// Correct on the angle, the innovation taken the short way round.
+		const float innovation = wrap_signed(counts[i] * RAD_PER_COUNT - angle);
+		const float s = p00 + r;
+		const float k0 = p00 / s;
+		const float k1 = p01 / s;
+		angle_[i] = wrap_positive(angle + k0 * innovation);
+		speed_[i] = speed + k1 * innovation;
+		p00_[i] = (1 - k0) * p00;
+		p01_[i] = (1 - k0) * p01;
+		p11_[i] = p11 - k1 * p01;
+	}
+	started_ = true;
+}
+
+void WheelStateEstimator::start(uint8_t i, uint16_t count, uint32_t time_us,
+		float commanded) {
+	angle_[i] = count * RAD_PER_COUNT;
+	speed_[i] = commanded;
+	commanded_[i] = commanded;
+	time_[i] = time_us;
+	p00_[i] = noise_.measurement;
+	p01_[i] = 0;
+	p11_[i] = INITIAL_SPEED_VARIANCE;
+}
@@ -0,0 +1,200 @@
+#include "commands.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#include "test.hpp"
+
+// Dispatch cost of the host's command table against the opcode switch it replaced, on the real command structs:
+// each execute() here only takes in its payload, so what's left to time is the dispatch.
+
+static volatile uint32_t checksum = 0;
+
+#define EXECUTE_EMPTY(T) void T::execute() { checksum = checksum + 1; }
+#define EXECUTE_PAYLOAD(T) void T::execute() { \
+		checksum = checksum + *reinterpret_cast<const uint8_t*>(this) + 1; }
+
+EXECUTE_PAYLOAD(SetServoCommand)
+EXECUTE_EMPTY(ReadWheelInfoCommand)
+EXECUTE_PAYLOAD(SetWheelSpeedsCommand)
+EXECUTE_EMPTY(StopSteppersCommand)
+EXECUTE_EMPTY(PongCommand)
+EXECUTE_PAYLOAD(InverseKinematicsCommand)
+EXECUTE_PAYLOAD(InverseKinematicsFloatCommand)
+EXECUTE_PAYLOAD(LcdPrintCommand)
+EXECUTE_PAYLOAD(SubscribeTelemetryCommand)
+EXECUTE_EMPTY(UnsubscribeTelemetryCommand)
+EXECUTE_EMPTY(ReadVelocityCommitStatsCommand)
+EXECUTE_EMPTY(ReadStepperLostWritesCommand)
+EXECUTE_EMPTY(ReadStepperStatusCommand)
+EXECUTE_PAYLOAD(SetRampLimitsCommand)
+EXECUTE_PAYLOAD(SetMotionBackendCommand)
+EXECUTE_EMPTY(ReadStepCountsCommand)
+EXECUTE_EMPTY(ReadBootStatsCommand)
+EXECUTE_PAYLOAD(SetSpeedLoopGainsCommand)
+EXECUTE_PAYLOAD(SetEncoderSampleRateCommand)
+EXECUTE_EMPTY(ReadEncoderSamplingStatsCommand)
+EXECUTE_PAYLOAD(SetEstimatorNoiseCommand)
+EXECUTE_PAYLOAD(LatchWheelTicksCommand)
+EXECUTE_PAYLOAD(ReadOdometryCommand)
+
+template<typename T>
+static void decode_and_execute(const uint8_t *payload) {
+	T cmd;
+	std::memcpy(&cmd, payload, sizeof(T));
+	cmd.execute();
+}
+
+// The shape of the switch Robot::recv_command had: a case per opcode, payload commands decoded by type and the
+// others executed straight away.
+static void dispatch_switch(uint8_t opcode, const uint8_t *payload) {
+	switch (opcode) {
+	case 's':
+		decode_and_execute<SetServoCommand>(payload);
+		break;
+	case 'a': {
+		ReadWheelInfoCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'u':
+		decode_and_execute<SetWheelSpeedsCommand>(payload);
+		break;
+	case 'x': {
+		StopSteppersCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'p': {
+		PongCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'k':
+		decode_and_execute<InverseKinematicsCommand>(payload);
+		break;
+	case 'K':
+		decode_and_execute<InverseKinematicsFloatCommand>(payload);
+		break;
+	case 'l':
+		decode_and_execute<LcdPrintCommand>(payload);
+		break;
+	case 'w':
+		decode_and_execute<SubscribeTelemetryCommand>(payload);
+		break;
+	case 'q': {
+		UnsubscribeTelemetryCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'v': {
+		ReadVelocityCommitStatsCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'e': {
+		ReadStepperLostWritesCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'd': {
+		ReadStepperStatusCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'r':
+		decode_and_execute<SetRampLimitsCommand>(payload);
+		break;
+	case 'm':
+		decode_and_execute<SetMotionBackendCommand>(payload);
+		break;
+	case 'c': {
+		ReadStepCountsCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'b': {
+		ReadBootStatsCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'g':
+		decode_and_execute<SetSpeedLoopGainsCommand>(payload);
+		break;
+	case 'f':
+		decode_and_execute<SetEncoderSampleRateCommand>(payload);
+		break;
+	case 'j': {
+		ReadEncoderSamplingStatsCommand cmd;
+		cmd.execute();
+		break;
+	}
+	case 'n':
+		decode_and_execute<SetEstimatorNoiseCommand>(payload);
+		break;
+	case 't':
+		decode_and_execute<LatchWheelTicksCommand>(payload);
+		break;
+	case 'o':
+		decode_and_execute<ReadOdometryCommand>(payload);
+		break;
+	default:
+		break;
+	}
+}
+
+static void dispatch_table(uint8_t opcode, const uint8_t *payload) {
+	const auto &cmd = HostCommands::lookup(opcode);
+	if (cmd.decode_and_execute != nullptr) {
+		cmd.decode_and_execute(payload);
+	}
+}
+
+constexpr size_t DISPATCHES = 1 << 22;
+
+template<typename Dispatch>
+static double ns_per_dispatch(const std::vector<uint8_t> &opcodes,
+		const uint8_t *payload, Dispatch dispatch, uint32_t &sum) {
+	checksum = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < DISPATCHES; ++i) {
+		dispatch(opcodes[i % opcodes.size()], payload);
+	}
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	sum = checksum;
+	return std::chrono::duration<double, std::nano>(elapsed).count()
+			/ DISPATCHES;
+}
+
+int main(void) {
+	const char known[] = "sauxpkKlwqvedrmcbgfjnto";
+	uint8_t payload[HostCommands::MAX_PAYLOAD_SIZE];
+	for (size_t i = 0; i < sizeof(payload); ++i) {
+		payload[i] = 1 + i;
+	}
+
+	// One opcode over and over, which the branch predictor learns, then a random mix of all of them, which it can't.
+	std::vector<uint8_t> repeated(1, 'u');
+	std::vector<uint8_t> mixed(4096);
+	uint32_t random = 1;
+	for (auto &opcode : mixed) {
+		random = random * 1103515245 + 12345;
+		opcode = known[(random >> 16) % (sizeof(known) - 1)];
+	}
+
+	for (const auto *opcodes : { &repeated, &mixed }) {
+		uint32_t switch_sum, table_sum;
+		const double switch_ns = ns_per_dispatch(*opcodes, payload,
+				dispatch_switch, switch_sum);
+		const double table_ns = ns_per_dispatch(*opcodes, payload,
+				dispatch_table, table_sum);
+		std::printf("%-9s switch %6.2f ns/command  table %6.2f ns/command\n",
+				opcodes == &repeated ? "repeated" : "mixed", switch_ns,
+				table_ns);
+		// Both dispatch every opcode to the same command.
+		CHECK_EQ(table_sum, switch_sum);
+	}
+	return TEST_RESULT();
+}
@@ -0,0 +1,240 @@
+#include "protocol.hpp"
+
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#include "command_table.hpp"
+#include "ring_buffer.hpp"
+#include "test.hpp"
+
+// Recovery after line noise, for the legacy 'M' protocol and the COBS framing: a stream of commands with noise bursts
+// injected into it goes through both parsers, and every command they execute is checked against what was sent.
+
+struct Executed {
+	uint32_t seq;
+	bool intact;
+};
+static std::vector<Executed> executed;
+
+#pragma pack(push, 1)
+// Stand-ins for the real commands' payloads, 12 bytes like 'u' and 24 like 'k', carrying their sequence number and a
+// check on it so that a command executed on a garbled payload shows up.
+template<size_t SIZE>
+struct SeqCommand {
+	uint32_t seq;
+	uint32_t check;
+	uint8_t padding[SIZE - 8];
+
+	void execute() {
+		executed.push_back( { seq, check == ~seq });
+	}
+};
+#pragma pack(pop)
+
+using SmallCommand = SeqCommand<12>;
+using LargeCommand = SeqCommand<24>;
+using Commands = CommandTable<Cmd<'u', SmallCommand>, Cmd<'k', LargeCommand>>;
+
+using Buffer = RingBuffer<256>;
+
+// The same steps as Robot::recv_legacy_command, returning false where it would wait for more bytes.
+static bool recv_legacy_command(Buffer &buf) {
+	const auto spans = buf.peek_span(2 + Commands::MAX_PAYLOAD_SIZE);
+	uint8_t frame[2];
+	if (!spans.copy(frame, 2))
+		return false;
+	if (frame[0] != 'M') {
+		buf.commit(spans, 1);
+		return true;
+	}
+	const auto &cmd = Commands::lookup(frame[1]);
+	if (cmd.decode_and_execute == nullptr) {
+		buf.commit(spans, 2);
+		return true;
+	}
+	uint8_t payload[Commands::MAX_PAYLOAD_SIZE];
+	if (!spans.copy(payload, cmd.payload_size, 2))
+		return false;
+	buf.commit(spans, 2 + cmd.payload_size);
+	cmd.decode_and_execute(payload);
+	return true;
+}
+
+// The same steps as Robot::recv_frame.
+static bool recv_frame(Buffer &buf) {
+	const auto spans = buf.peek_span(MAX_ENCODED_FRAME_SIZE);
+	uint8_t frame[MAX_ENCODED_FRAME_SIZE];
+	spans.copy(frame, spans.size());
+	const auto end = static_cast<const uint8_t*>(std::memchr(frame,
+			FRAME_DELIMITER, spans.size()));
+	if (end == nullptr) {
+		if (spans.size() == MAX_ENCODED_FRAME_SIZE) {
+			buf.commit(spans, spans.size());
+			return true;
+		}
+		return false;
+	}
+	const size_t frame_len = end - frame;
+	buf.commit(spans, frame_len + 1);
+	if (frame_len == 0)
+		return true;
+
+	const size_t len = cobs_decode(frame, frame_len, frame);
+	if (len < 1 + FRAME_CRC_SIZE)
+		return true;
+	const uint16_t crc = frame[len - 2] | (frame[len - 1] << 8);
+	if (crc16(frame, len - FRAME_CRC_SIZE) != crc)
+		return true;
+	const auto &cmd = Commands::lookup(frame[0]);
+	if (cmd.decode_and_execute == nullptr
+			|| cmd.payload_size != len - 1 - FRAME_CRC_SIZE)
+		return true;
+	cmd.decode_and_execute(frame + 1);
+	return true;
+}
+
+static uint32_t random_state;
+static uint32_t next_random(uint32_t range) {
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) % range;
+}
+
+// Where each command and each noise burst sits in the stream, in bytes.
+struct Stream {
+	std::vector<uint8_t> bytes;
+	std::vector<size_t> command_end;
+	std::vector<size_t> noise_end;
+};
+
+static Stream make_stream(bool cobs, size_t noise_length) {
+	Stream stream;
+	random_state = 2024;
+	for (uint32_t seq = 0; seq < 3000; ++seq) {
+		// Noise before one command in ten, some of the time landing inside the previous one.
+		if (seq % 10 == 5) {
+			const size_t at = next_random(2) == 0 ?
+					stream.bytes.size() :
+					stream.bytes.size() - 1 - next_random(8);
+			std::vector<uint8_t> noise(noise_length);
+			for (auto &byte : noise) {
+				// Noise on a line carrying floats and 'M' headers: plenty of 'M's, and the odd 0x00.
+				const uint32_t kind = next_random(8);
+				byte = kind == 0 ? 'M' : kind == 1 ? 0 : next_random(256);
+			}
+			stream.bytes.insert(stream.bytes.begin() + at, noise.begin(),
+					noise.end());
+			stream.noise_end.push_back(at + noise_length);
+			if (at < stream.bytes.size() - noise_length) {
+				stream.command_end.back() += noise_length;
+			}
+		}
+
+		const bool large = next_random(2) == 0;
+		uint8_t payload[sizeof(LargeCommand)] { };
+		const uint32_t check = ~seq;
+		std::memcpy(payload, &seq, 4);
+		std::memcpy(payload + 4, &check, 4);
+		// Payload bytes that look like headers and delimiters, the way floats do.
+		for (size_t i = 8; i < sizeof(payload); ++i) {
+			payload[i] = next_random(4) == 0 ? 'M' : next_random(256);
+		}
+		const uint8_t opcode = large ? 'k' : 'u';
+		const size_t payload_size =
+				large ? sizeof(LargeCommand) : sizeof(SmallCommand);
+		if (cobs) {
+			uint8_t frame[MAX_ENCODED_FRAME_SIZE];
+			const size_t len = frame_encode(opcode, payload, payload_size,
+					frame);
+			stream.bytes.insert(stream.bytes.end(), frame, frame + len);
+		} else {
+			stream.bytes.push_back('M');
+			stream.bytes.push_back(opcode);
+			stream.bytes.insert(stream.bytes.end(), payload,
+					payload + payload_size);
+		}
+		stream.command_end.push_back(stream.bytes.size());
+	}
+	return stream;
+}
+
+struct Result {
+	size_t intact, lost, garbled;
+	double mean_recovery_bytes;
+	size_t worst_recovery_bytes;
+};
+
+static Result run(bool cobs, size_t noise_length) {
+	const Stream stream = make_stream(cobs, noise_length);
+	executed.clear();
+	Buffer buf;
+
+	// Fed in 16 byte chunks, as DMA would, the parser catching up after each, and each execution noted with how far
+	// into the stream it happened.
+	std::vector<size_t> executed_at;
+	for (size_t offset = 0; offset < stream.bytes.size(); offset += 16) {
+		const size_t end = std::min(offset + 16, stream.bytes.size());
+		for (size_t i = offset; i < end; ++i) {
+			buf.push(stream.bytes[i]);
+		}
+		while (cobs ? recv_frame(buf) : recv_legacy_command(buf)) {
+			while (executed_at.size() < executed.size()) {
+				executed_at.push_back(end);
+			}
+		}
+	}
+
+	Result result { };
+	std::vector<bool> seen(stream.command_end.size());
+	for (const auto &command : executed) {
+		if (command.intact && command.seq < seen.size() && !seen[command.seq]) {
+			seen[command.seq] = true;
+			++result.intact;
+		} else {
+			++result.garbled;
+		}
+	}
+	result.lost = seen.size() - result.intact;
+
+	// Recovery: from the end of each noise burst to the end of the first intact command executed after it.
+	size_t total = 0;
+	for (const size_t noise_end : stream.noise_end) {
+		size_t recovered_at = stream.bytes.size();
+		for (size_t i = 0; i < executed.size(); ++i) {
+			const auto &command = executed[i];
+			if (command.intact && command.seq < seen.size()
+					&& stream.command_end[command.seq] > noise_end
+					&& executed_at[i] >= noise_end) {
+				recovered_at = stream.command_end[command.seq];
+				break;
+			}
+		}
+		const size_t recovery = recovered_at - noise_end;
+		total += recovery;
+		result.worst_recovery_bytes = std::max(result.worst_recovery_bytes,
+				recovery);
+	}
+	result.mean_recovery_bytes = static_cast<double>(total)
+			/ stream.noise_end.size();
+	return result;
+}
+
+int main(void) {
+	std::printf("300 noise bursts in 3000 commands, recovery in bytes after each burst (87 us each at 115200 baud)\n");
+	for (const size_t noise_length : { 1, 4, 16, 64 }) {
+		const Result legacy = run(false, noise_length);
+		const Result cobs = run(true, noise_length);
+		std::printf(
+				"noise %2zu B  legacy: %4zu lost, %4zu garbled, recovery mean %6.1f worst %5zu"
+						"  |  COBS: %4zu lost, %zu garbled, recovery mean %6.1f worst %5zu\n",
+				noise_length, legacy.lost, legacy.garbled,
+				legacy.mean_recovery_bytes, legacy.worst_recovery_bytes,
+				cobs.lost, cobs.garbled, cobs.mean_recovery_bytes,
+				cobs.worst_recovery_bytes);
+
+		// COBS loses at most the frame each burst lands in or next to, and never executes a garbled one.
+		CHECK(cobs.lost <= 300);
+		CHECK_EQ(cobs.garbled, 0u);
+	}
+	return TEST_RESULT();
+}
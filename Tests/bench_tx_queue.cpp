@@ -0,0 +1,148 @@
+#include "tx_queue.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "test.hpp"
+
+// Reply latency and main loop stall through a stand-in for the host UART, in simulated time at 115200 baud, while
+// telemetry streamed at the top rate keeps the link saturated.
+
+constexpr double BYTE_US = 10 * 1e6 / 115200;
+// A COBS framed WheelTelemetry sample, and a COBS framed reply to 'a' (WheelInfo).
+constexpr size_t TELEMETRY_FRAME_SIZE = 77;
+constexpr size_t REPLY_FRAME_SIZE = 53;
+constexpr double TELEMETRY_PERIOD_US = 1e6 / TELEMETRY_MAX_RATE_HZ;
+constexpr double NEVER = INFINITY;
+
+static TxQueue queue;
+static double now_us = 0;
+static double uart_done_at = NEVER;
+static double next_telemetry_at = 0;
+static uint32_t next_telemetry_seq = 0;
+
+// Frames are tagged with their kind and a sequence number, and each reply's time on the wire is noted as it ends.
+struct Tag {
+	uint8_t kind;
+	uint32_t seq;
+};
+static Tag on_the_wire;
+static std::vector<double> reply_done_at;
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef*,
+		const uint8_t *data, uint16_t size) {
+	std::memcpy(&on_the_wire, data, sizeof(on_the_wire));
+	uart_done_at = now_us + size * BYTE_US;
+	return HAL_OK;
+}
+
+static void send_frame(uint8_t kind, uint32_t seq, size_t size) {
+	uint8_t frame[TxQueue::FRAME_CAPACITY] { };
+	const Tag tag { kind, seq };
+	std::memcpy(frame, &tag, sizeof(tag));
+	queue.send(frame, size,
+			kind == 'R' ? TxQueue::Kind::REPLY : TxQueue::Kind::TELEMETRY);
+}
+
+// Interrupts that come due by `t`, in order: transfers completing, and the telemetry timer.
+static void run_until(double t) {
+	while (std::fmin(uart_done_at, next_telemetry_at) <= t) {
+		if (uart_done_at <= next_telemetry_at) {
+			now_us = uart_done_at;
+			uart_done_at = NEVER;
+			if (on_the_wire.kind == 'R') {
+				reply_done_at[on_the_wire.seq] = now_us;
+			}
+			queue.on_tx_complete();
+		} else {
+			now_us = next_telemetry_at;
+			next_telemetry_at += TELEMETRY_PERIOD_US;
+			send_frame('T', next_telemetry_seq++, TELEMETRY_FRAME_SIZE);
+		}
+	}
+	now_us = t;
+}
+
+// The main loop sleeping in TxQueue::send until the next interrupt.
+static void wait_for_interrupt(void) {
+	run_until(std::fmin(uart_done_at, next_telemetry_at));
+}
+
+struct Result {
+	double mean_latency_us, worst_latency_us;
+	double mean_stall_us, worst_stall_us;
+	size_t replies_sent;
+};
+
+// A command every `period_us`, each answered with `replies` replies in a row.
+static Result run(size_t commands, size_t replies, double period_us) {
+	UART_HandleTypeDef huart { };
+	queue = TxQueue();
+	queue.init(&huart);
+	now_us = 0;
+	uart_done_at = NEVER;
+	next_telemetry_at = 0;
+	next_telemetry_seq = 0;
+	reply_done_at.assign(commands * replies, NEVER);
+	std::vector<double> queued_at(commands * replies);
+	wfi_hook = wait_for_interrupt;
+
+	Result result { };
+	for (size_t command = 0; command < commands; ++command) {
+		run_until(1000 + command * period_us);
+		const double start = now_us;
+		for (size_t i = 0; i < replies; ++i) {
+			const uint32_t seq = command * replies + i;
+			queued_at[seq] = now_us;
+			send_frame('R', seq, REPLY_FRAME_SIZE);
+		}
+		const double stall = now_us - start;
+		result.mean_stall_us += stall / commands;
+		result.worst_stall_us = std::max(result.worst_stall_us, stall);
+	}
+	run_until(now_us + 1e6);
+	wfi_hook = nullptr;
+
+	for (size_t seq = 0; seq < reply_done_at.size(); ++seq) {
+		if (reply_done_at[seq] == NEVER)
+			continue;
+		++result.replies_sent;
+		const double latency = reply_done_at[seq] - queued_at[seq];
+		result.mean_latency_us += latency / reply_done_at.size();
+		result.worst_latency_us = std::max(result.worst_latency_us, latency);
+	}
+	return result;
+}
+
+static void report(const char *name, const Result &result) {
+	std::printf(
+			"%-38s reply latency mean %6.0f worst %6.0f us  main loop stall mean %6.0f worst %6.0f us\n",
+			name, result.mean_latency_us, result.worst_latency_us,
+			result.mean_stall_us, result.worst_stall_us);
+}
+
+int main(void) {
+	// What the blocking HAL_UART_Transmit replies cost before, with nothing else on the link: the main loop waits out
+	// the whole reply.
+	const double blocking_us = sizeof(double) * 6 * BYTE_US;
+	std::printf("%-38s reply latency %6.0f us, main loop stall %6.0f us\n",
+			"blocking, idle link", blocking_us, blocking_us);
+
+	const Result single = run(500, 1, 20000);
+	report("queued, saturated, 1 reply/20 ms", single);
+	// More replies at once than the queue has slots: the last ones wait for the first to go out.
+	const Result burst = run(100, USB_TX_QUEUE_LENGTH + 4, 100000);
+	report("queued, saturated, 12 replies/100 ms", burst);
+
+	// Every reply goes out. A lone reply never stalls the main loop, and waits at most for the frames already queued
+	// ahead of it, all of them telemetry at worst.
+	CHECK_EQ(single.replies_sent, 500u);
+	CHECK_EQ(single.worst_stall_us, 0);
+	CHECK(single.worst_latency_us
+			<= USB_TX_QUEUE_LENGTH * TELEMETRY_FRAME_SIZE * BYTE_US
+					+ REPLY_FRAME_SIZE * BYTE_US);
+	CHECK_EQ(burst.replies_sent, 100 * (USB_TX_QUEUE_LENGTH + 4));
+	CHECK(burst.worst_stall_us > 0);
+	return TEST_RESULT();
+}
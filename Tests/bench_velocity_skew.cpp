@@ -0,0 +1,116 @@
+#include <cmath>
+#include <initializer_list>
+
+#include "kinematics.hpp"
+#include "peripherals/tmc2209_datagram.hpp"
+#include "test.hpp"
+#include "velocity_ramp.hpp"
+
+// Heading error from the drivers taking a new velocity at different times, before and after the synchronised commit:
+// the base is driven through quick direction changes with no rotation commanded, so with the velocities stepped, any
+// heading it ends up with is the skew's doing.
+
+constexpr double BAUD = 115200;
+constexpr double DATAGRAM_US = TMC_WRITE_DATAGRAM_SIZE * 10 * 1e6 / BAUD;
+// Before: three separate write transactions, wheel 3 taking its velocity about 1.7 ms after wheel 1.
+constexpr double SEQUENTIAL_DELAYS_US[WHEEL_COUNT] = { 0, 850, 1700 };
+// After: one burst, each driver taking its datagram as it ends, back to back.
+constexpr double BURST_DELAYS_US[WHEEL_COUNT] = { 0, DATAGRAM_US, 2
+		* DATAGRAM_US };
+constexpr double NO_DELAYS_US[WHEEL_COUNT] = { 0, 0, 0 };
+constexpr double TICK_US = 1e6 / VELOCITY_COMMIT_RATE_HZ;
+constexpr double STEP_US = 1;
+
+struct Twist {
+	double x_dot, y_dot;
+};
+
+// Wheel speeds in rad/s for a twist without rotation.
+static void wheel_speeds(const Twist &twist, double *speeds) {
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		speeds[i] = IK_MATRIX[i][0] * twist.x_dot
+				+ IK_MATRIX[i][1] * twist.y_dot;
+	}
+}
+
+// Drives `from` for 100 ms, then `to` for 400 ms, the velocities sent on the motion tick through each wheel's ramp
+// and taken up by each driver `delays_us` after the tick. Returns the heading the base ends up with, in rad.
+static double heading_error(const Twist &from, const Twist &to,
+		const double *delays_us, const RampLimits &limits) {
+	double before[WHEEL_COUNT], after[WHEEL_COUNT];
+	wheel_speeds(from, before);
+	wheel_speeds(to, after);
+
+	VelocityRamp ramps[WHEEL_COUNT];
+	// What each driver is running at, and what it will take up next and when.
+	double running[WHEEL_COUNT], pending[WHEEL_COUNT], pending_at[WHEEL_COUNT];
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		ramps[i].step(before[i], { 0, 0 }, TICK_US * 1e-6f);
+		running[i] = pending[i] = before[i];
+		pending_at[i] = INFINITY;
+	}
+
+	double psi = 0;
+	double next_tick = 0;
+	for (double t = 0; t < 500000; t += STEP_US) {
+		if (t >= next_tick) {
+			const double *targets = t < 100000 ? before : after;
+			for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+				pending[i] = ramps[i].step(targets[i], limits,
+						TICK_US * 1e-6f);
+				pending_at[i] = t + delays_us[i];
+			}
+			next_tick += TICK_US;
+		}
+		double psi_dot = 0;
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			if (t >= pending_at[i]) {
+				running[i] = pending[i];
+			}
+			psi_dot += FK_MATRIX[2][i] * running[i];
+		}
+		psi += psi_dot * STEP_US * 1e-6;
+	}
+	return psi;
+}
+
+int main(void) {
+	const Twist maneuvers[][2] = { { { 0.5, 0 }, { -0.5, 0 } }, { { 0, 0.5 }, {
+			0, -0.5 } }, { { 0.4, 0.3 }, { -0.3, 0.4 } }, { { 0, 0 }, { 0.5,
+			0 } } };
+	const char *names[] = { "x reversal 0.5 m/s", "y reversal 0.5 m/s",
+			"90 deg turn of travel", "start from rest" };
+	const RampLimits step { 0, 0 };
+	const RampLimits ramped { static_cast<float>(RAMP_MAX_ACCELERATION),
+			static_cast<float>(RAMP_MAX_JERK) };
+
+	std::printf("heading error in mrad (cross-track drift in mm per metre travelled after it)\n");
+	std::printf("%-24s %18s %18s %18s\n", "", "sequential, step",
+			"burst, step", "burst, ramped *");
+	for (size_t m = 0; m < 4; ++m) {
+		const double sequential = heading_error(maneuvers[m][0],
+				maneuvers[m][1], SEQUENTIAL_DELAYS_US, step);
+		const double burst = heading_error(maneuvers[m][0], maneuvers[m][1],
+				BURST_DELAYS_US, step);
+		// Each wheel ramps on its own, and those with further to go take longer: that turns the base too, skew or
+		// not. Only what the skew adds on top is the burst's to answer for.
+		const double burst_ramped = heading_error(maneuvers[m][0],
+				maneuvers[m][1], BURST_DELAYS_US, ramped)
+				- heading_error(maneuvers[m][0], maneuvers[m][1], NO_DELAYS_US,
+						ramped);
+		std::printf("%-24s %18.3f %18.3f %18.3f\n", names[m],
+				sequential * 1e3, burst * 1e3, burst_ramped * 1e3);
+
+		// The burst's skew is shorter. Ramping spreads a change over many ticks, each of them skewed the same way, so
+		// the skew's part comes to about the same as stepping and no more.
+		CHECK(std::fabs(burst) <= std::fabs(sequential));
+		CHECK(std::fabs(burst_ramped) <= std::fabs(burst) + 1e-6);
+	}
+
+	std::printf("* the skew's part only, the ramps' own heading error taken out\n");
+
+	// With no skew at all, there's no heading error: the simulation itself doesn't add any.
+	CHECK_NEAR(heading_error(maneuvers[0][0], maneuvers[0][1], NO_DELAYS_US,
+			step), 0, 1e-9);
+	return TEST_RESULT();
+}
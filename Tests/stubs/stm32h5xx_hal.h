@@ -0,0 +1,92 @@
+#pragma once
+
+// Stands in for the HAL on the host, for the tests of code that only needs a few of its types and calls: the calls
+// are declared here and defined by the tests that use them, to play the hardware's part. Register level macros do
+// nothing.
+
+#include <cstdint>
+
+typedef enum {
+	HAL_OK = 0x00, HAL_ERROR = 0x01, HAL_BUSY = 0x02, HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+// UART
+
+typedef enum {
+	HAL_UART_STATE_RESET = 0x00, HAL_UART_STATE_READY = 0x20, HAL_UART_STATE_BUSY = 0x24
+} HAL_UART_StateTypeDef;
+
+typedef struct {
+	uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct {
+	UART_InitTypeDef Init;
+	volatile HAL_UART_StateTypeDef gState;
+	volatile HAL_UART_StateTypeDef RxState;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart,
+		const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart,
+		uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_ReceiverTimeout_Config(UART_HandleTypeDef *huart,
+		uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_EnableReceiverTimeout(UART_HandleTypeDef *huart);
+
+#define UART_RXDATA_FLUSH_REQUEST 0
+#define UART_CLEAR_OREF 0
+#define UART_CLEAR_NEF 0
+#define UART_CLEAR_FEF 0
+#define UART_CLEAR_RTOF 0
+#define __HAL_UART_SEND_REQ(huart, request) ((void) (huart))
+#define __HAL_UART_CLEAR_FLAG(huart, flags) ((void) (huart))
+
+// GPIO
+
+typedef struct {
+	uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+	GPIO_PIN_RESET = 0, GPIO_PIN_SET
+} GPIO_PinState;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+
+// Core: the cycle counter is a plain variable for the tests to move on, and interrupts don't exist, so critical
+// sections do nothing. Waiting for an interrupt calls wfi_hook, if a test has set one, to deliver the next one.
+
+typedef struct {
+	uint32_t CTRL;
+	uint32_t CYCCNT;
+} DWT_Type;
+typedef struct {
+	uint32_t DEMCR;
+} DCB_Type;
+inline DWT_Type dwt_stub;
+inline DCB_Type dcb_stub;
+#define DWT (&dwt_stub)
+#define DCB (&dcb_stub)
+#define DWT_CTRL_CYCCNTENA_Msk 1u
+#define DCB_DEMCR_TRCENA_Msk (1u << 24)
+
+inline uint32_t SystemCoreClock = 64000000;
+
+inline uint32_t __get_PRIMASK(void) {
+	return 0;
+}
+inline void __set_PRIMASK(uint32_t) {
+}
+inline void __disable_irq(void) {
+}
+inline uint32_t __get_IPSR(void) {
+	return 0; // Thread mode.
+}
+inline void (*wfi_hook)(void) = nullptr;
+inline void __WFI(void) {
+	if (wfi_hook != nullptr) {
+		wfi_hook();
+	}
+}
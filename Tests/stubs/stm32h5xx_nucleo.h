@@ -0,0 +1,3 @@
+#pragma once
+
+// Nothing from the board support package is needed on the host.
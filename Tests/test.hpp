@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+// Just enough of a test framework: a failed check prints where it failed and carries on, and the test's main returns
+// TEST_RESULT() so that ctest sees any failure.
+inline int& test_failures() {
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++test_failures(); \
+		} \
+	} while (0)
+
+#define CHECK_EQ(actual, expected) \
+	do { \
+		const auto actual_ = (actual); \
+		const auto expected_ = (expected); \
+		if (!(actual_ == expected_)) { \
+			std::printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #actual, #expected, \
+					static_cast<long long>(actual_), static_cast<long long>(expected_)); \
+			++test_failures(); \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { \
+		const double actual_ = (actual); \
+		const double expected_ = (expected); \
+		if (!(std::fabs(actual_ - expected_) <= (tolerance))) { \
+			std::printf("%s:%d: CHECK_NEAR(%s, %s) failed: %g != %g\n", __FILE__, __LINE__, #actual, #expected, \
+					actual_, expected_); \
+			++test_failures(); \
+		} \
+	} while (0)
+
+#define TEST_RESULT() (test_failures() == 0 ? 0 : 1)
@@ -0,0 +1,62 @@
+#include "command_table.hpp"
+
+#include <cstring>
+
+#include "test.hpp"
+
+static int executed = 0;
+static int32_t last_value = 0;
+
+#pragma pack(push, 1)
+struct EmptyCommand {
+	void execute() {
+		++executed;
+	}
+};
+struct ValueCommand {
+	int32_t value;
+	uint8_t flag;
+	void execute() {
+		++executed;
+		last_value = flag ? value : -value;
+	}
+};
+#pragma pack(pop)
+
+using Commands = CommandTable<Cmd<'e', EmptyCommand>, Cmd<'v', ValueCommand>>;
+
+static void payload_sizes(void) {
+	CHECK_EQ(Commands::lookup('e').payload_size, 0u);
+	CHECK_EQ(Commands::lookup('v').payload_size, sizeof(ValueCommand));
+	CHECK_EQ(Commands::MAX_PAYLOAD_SIZE, sizeof(ValueCommand));
+}
+
+static void unknown_opcodes(void) {
+	for (int opcode = 0; opcode < 256; ++opcode) {
+		if (opcode == 'e' || opcode == 'v')
+			continue;
+		CHECK(Commands::lookup(opcode).decode_and_execute == nullptr);
+	}
+}
+
+static void decode_and_execute(void) {
+	executed = 0;
+	Commands::lookup('e').decode_and_execute(nullptr);
+	CHECK_EQ(executed, 1);
+
+	// Decoded from an unaligned, packed payload the way it comes out of the receive buffer.
+	uint8_t buffer[1 + sizeof(ValueCommand)];
+	const int32_t value = -123456;
+	std::memcpy(buffer + 1, &value, sizeof(value));
+	buffer[1 + sizeof(value)] = 1;
+	Commands::lookup('v').decode_and_execute(buffer + 1);
+	CHECK_EQ(executed, 2);
+	CHECK_EQ(last_value, -123456);
+}
+
+int main(void) {
+	payload_sizes();
+	unknown_opcodes();
+	decode_and_execute();
+	return TEST_RESULT();
+}
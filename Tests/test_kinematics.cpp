@@ -0,0 +1,75 @@
+#include "kinematics.hpp"
+
+#include "test.hpp"
+
+static void q16_16_arithmetic(void) {
+	CHECK_EQ(Q16_16(1.5).raw(), 3 << 15);
+	CHECK_EQ(Q16_16(-1.5).raw(), -(3 << 15));
+	CHECK_EQ(static_cast<int32_t>(Q16_16(2.5) * Q16_16(-4.0)), -10);
+	CHECK_EQ(static_cast<int32_t>(Q16_16(3.25) + Q16_16(0.75)), 4);
+	CHECK_EQ(static_cast<int32_t>(Q16_16(1.0) - Q16_16(3.5)), -2); // Toward zero.
+	CHECK_EQ(static_cast<int32_t>(-Q16_16(7.9)), -7);
+	// Products keep their fractional bits.
+	CHECK_EQ((Q16_16(0.5) * Q16_16(0.5)).raw(), Q16_16(0.25).raw());
+}
+
+// What the inverse kinematics should give, in double straight from IK_MATRIX.
+static void reference_inverse(double x_dot, double y_dot, double theta_dot,
+		double *vactual) {
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		vactual[i] = (IK_MATRIX[i][0] * x_dot + IK_MATRIX[i][1] * y_dot
+				+ IK_MATRIX[i][2] * theta_dot) * RAD_PER_S_TO_VACTUAL;
+	}
+}
+
+static void inverse_matches_reference(void) {
+	const double twists[][3] = { { 0, 0, 0 }, { 0.5, 0, 0 }, { 0, -0.5, 0 }, {
+			0, 0, 2 }, { 0.3, 0.4, -1.5 }, { -0.8, 0.2, 0.7 } };
+	for (const auto &twist : twists) {
+		double expected[WHEEL_COUNT];
+		reference_inverse(twist[0], twist[1], twist[2], expected);
+
+		int32_t vactual[WHEEL_COUNT];
+		Kinematics<float>::inverse(twist[0], twist[1], twist[2], vactual);
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			CHECK_NEAR(vactual[i], expected[i], 1);
+		}
+		Kinematics<Q16_16>::inverse(Q16_16(twist[0]), Q16_16(twist[1]),
+				Q16_16(twist[2]), vactual);
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			CHECK_NEAR(vactual[i], expected[i], 1);
+		}
+	}
+}
+
+// The forward kinematics give back the twist the inverse kinematics were given.
+static void forward_inverts_inverse(void) {
+	const double twist[3] = { 0.3, -0.2, 1.1 };
+	double wheels[WHEEL_COUNT];
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		wheels[i] = IK_MATRIX[i][0] * twist[0] + IK_MATRIX[i][1] * twist[1]
+				+ IK_MATRIX[i][2] * twist[2];
+	}
+	for (uint8_t row = 0; row < 3; ++row) {
+		double rate = 0;
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			rate += FK_MATRIX[row][i] * wheels[i];
+		}
+		CHECK_NEAR(rate, twist[row], 1e-12);
+	}
+}
+
+static void wheel_speed_to_vactual(void) {
+	CHECK_NEAR(Kinematics<float>::rad_per_s_to_vactual(10),
+			10 * RAD_PER_S_TO_VACTUAL, 1);
+	CHECK_NEAR(Kinematics<float>::rad_per_s_to_vactual(-3),
+			-3 * RAD_PER_S_TO_VACTUAL, 1);
+}
+
+int main(void) {
+	q16_16_arithmetic();
+	inverse_matches_reference();
+	forward_inverts_inverse();
+	wheel_speed_to_vactual();
+	return TEST_RESULT();
+}
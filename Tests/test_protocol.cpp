@@ -0,0 +1,105 @@
+#include "protocol.hpp"
+
+#include <cstring>
+#include <initializer_list>
+
+#include "test.hpp"
+
+static void crc16_check_value(void) {
+	// The catalogued check value for CRC-16/CCITT-FALSE.
+	const char *check = "123456789";
+	CHECK_EQ(crc16(reinterpret_cast<const uint8_t*>(check), 9), 0x29B1);
+	CHECK_EQ(crc16(nullptr, 0), 0xFFFF);
+	// Continuing from a previous CRC is the same as doing it all at once.
+	const uint16_t head = crc16(reinterpret_cast<const uint8_t*>(check), 4);
+	CHECK_EQ(crc16(reinterpret_cast<const uint8_t*>(check) + 4, 5, head),
+			0x29B1);
+}
+
+static bool encodes_to(const uint8_t *src, size_t len, const uint8_t *expected,
+		size_t expected_len) {
+	uint8_t dst[MAX_ENCODED_FRAME_SIZE * 4];
+	return cobs_encode(src, len, dst) == expected_len
+			&& std::memcmp(dst, expected, expected_len) == 0;
+}
+
+static void cobs_vectors(void) {
+	const uint8_t zero[] = { 0x00 };
+	const uint8_t zero_encoded[] = { 0x01, 0x01, 0x00 };
+	CHECK(encodes_to(zero, sizeof(zero), zero_encoded, sizeof(zero_encoded)));
+
+	const uint8_t zeros[] = { 0x00, 0x00 };
+	const uint8_t zeros_encoded[] = { 0x01, 0x01, 0x01, 0x00 };
+	CHECK(encodes_to(zeros, sizeof(zeros), zeros_encoded,
+			sizeof(zeros_encoded)));
+
+	const uint8_t mixed[] = { 0x11, 0x22, 0x00, 0x33 };
+	const uint8_t mixed_encoded[] = { 0x03, 0x11, 0x22, 0x02, 0x33, 0x00 };
+	CHECK(encodes_to(mixed, sizeof(mixed), mixed_encoded,
+			sizeof(mixed_encoded)));
+
+	const uint8_t trailing[] = { 0x11, 0x00, 0x00, 0x00 };
+	const uint8_t trailing_encoded[] = { 0x02, 0x11, 0x01, 0x01, 0x01, 0x00 };
+	CHECK(encodes_to(trailing, sizeof(trailing), trailing_encoded,
+			sizeof(trailing_encoded)));
+}
+
+// Every length up to past a full 254 byte block, with and without zeros in it.
+static void cobs_round_trips(void) {
+	for (size_t len = 0; len <= 600; ++len) {
+		for (int zero_every : { 0, 1, 7, 300 }) {
+			uint8_t src[600], encoded[700], decoded[700];
+			for (size_t i = 0; i < len; ++i) {
+				src[i] = zero_every != 0 && i % zero_every == 0 ? 0 : 1 + i % 255;
+			}
+			const size_t encoded_len = cobs_encode(src, len, encoded);
+			CHECK(encoded_len <= len + len / 254 + 2);
+			CHECK_EQ(encoded[encoded_len - 1], FRAME_DELIMITER);
+			CHECK(std::memchr(encoded, FRAME_DELIMITER, encoded_len - 1) == nullptr);
+
+			const size_t decoded_len = cobs_decode(encoded, encoded_len - 1,
+					decoded);
+			CHECK_EQ(decoded_len, len);
+			CHECK(std::memcmp(decoded, src, len) == 0);
+		}
+	}
+}
+
+static void cobs_rejects_malformed(void) {
+	// A block running past the end of the frame.
+	const uint8_t overrun[] = { 0x05, 0x11, 0x22 };
+	uint8_t dst[8];
+	CHECK_EQ(cobs_decode(overrun, sizeof(overrun), dst), 0u);
+	// A delimiter inside the frame.
+	const uint8_t delimiter[] = { 0x02, 0x11, 0x00, 0x22 };
+	CHECK_EQ(cobs_decode(delimiter, sizeof(delimiter), dst), 0u);
+}
+
+static void frame_round_trip(void) {
+	uint8_t payload[MAX_FRAME_PAYLOAD];
+	for (size_t i = 0; i < sizeof(payload); ++i) {
+		payload[i] = i % 3 == 0 ? 0 : i;
+	}
+	uint8_t frame[MAX_ENCODED_FRAME_SIZE];
+	const size_t len = frame_encode('w', payload, sizeof(payload), frame);
+	CHECK(len > 0 && len <= MAX_ENCODED_FRAME_SIZE);
+
+	// As the receiver does it: decode in place, then check the CRC over opcode and payload.
+	const size_t decoded = cobs_decode(frame, len - 1, frame);
+	CHECK_EQ(decoded, 1 + sizeof(payload) + FRAME_CRC_SIZE);
+	CHECK_EQ(frame[0], 'w');
+	CHECK(std::memcmp(frame + 1, payload, sizeof(payload)) == 0);
+	const uint16_t crc = frame[decoded - 2] | (frame[decoded - 1] << 8);
+	CHECK_EQ(crc16(frame, decoded - FRAME_CRC_SIZE), crc);
+
+	CHECK_EQ(frame_encode('w', payload, MAX_FRAME_PAYLOAD + 1, frame), 0u);
+}
+
+int main(void) {
+	crc16_check_value();
+	cobs_vectors();
+	cobs_round_trips();
+	cobs_rejects_malformed();
+	frame_round_trip();
+	return TEST_RESULT();
+}
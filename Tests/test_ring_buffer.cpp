@@ -0,0 +1,296 @@
+#include "ring_buffer.hpp"
+
+#include <cstring>
+#include <vector>
+
+#include "protocol.hpp"
+#include "test.hpp"
+
+// Circular DMA writes straight into the storage, and the idle line and half/full transfer events publish its write
+// index with set_head.
+static void dma_producer(void) {
+	RingBuffer<16> buf;
+	uint8_t *storage = buf.storage();
+	for (uint8_t i = 0; i < 5; ++i) {
+		storage[i] = i;
+	}
+	buf.set_head(5);
+	CHECK_EQ(buf.available(), 5u);
+	uint8_t out[5];
+	CHECK(buf.peek(out, 5));
+	CHECK_EQ(out[4], 4);
+
+	// The same index again, e.g. an idle line right after a half transfer event: nothing new.
+	buf.set_head(5);
+	CHECK_EQ(buf.available(), 5u);
+	buf.commit(buf.peek_span(), 5);
+	CHECK(buf.empty());
+}
+
+// The DMA write index wraps back to the start of the storage.
+static void dma_wraps_around_the_storage(void) {
+	RingBuffer<16> buf;
+	uint8_t *storage = buf.storage();
+	buf.set_head(12);
+	buf.commit(buf.peek_span(), 12);
+
+	for (uint8_t i = 0; i < 8; ++i) {
+		storage[(12 + i) % 16] = 100 + i;
+	}
+	buf.set_head(4);
+	CHECK_EQ(buf.available(), 8u);
+	const auto spans = buf.peek_span();
+	CHECK_EQ(spans.first.size, 4u);
+	CHECK_EQ(spans.second.size, 4u);
+	CHECK_EQ(spans.first.data[0], 100);
+	CHECK_EQ(spans.second.data[0], 104);
+	uint8_t out[8];
+	CHECK(spans.copy(out, 8));
+	for (uint8_t i = 0; i < 8; ++i) {
+		CHECK_EQ(out[i], 100 + i);
+	}
+	// Copies starting in either span.
+	CHECK(spans.copy(out, 3, 2));
+	CHECK_EQ(out[2], 104);
+	CHECK(spans.copy(out, 2, 5));
+	CHECK_EQ(out[0], 105);
+	CHECK(!spans.copy(out, 2, 7));
+	CHECK_EQ(buf.dropped(), 0u);
+}
+
+static void push_pop_round_trip(void) {
+	RingBuffer<4, uint16_t> buf;
+	CHECK(buf.empty());
+	for (uint16_t i = 0; i < 4; ++i) {
+		CHECK(buf.push(1000 + i));
+	}
+	// All SIZE slots are usable, and a push into a full buffer is dropped and counted.
+	CHECK_EQ(buf.available(), 4u);
+	CHECK(!buf.push(2000));
+	CHECK_EQ(buf.dropped(), 1u);
+
+	uint16_t value = 0;
+	for (uint16_t i = 0; i < 4; ++i) {
+		CHECK(buf.pop(value));
+		CHECK_EQ(value, 1000 + i);
+	}
+	CHECK(!buf.pop(value));
+}
+
+// The indices run freely past SIZE, and elements keep coming out in order as they wrap around the storage.
+static void wraparound(void) {
+	RingBuffer<8> buf;
+	uint8_t next_in = 0, next_out = 0;
+	for (int round = 0; round < 100; ++round) {
+		for (int i = 0; i < 5; ++i) {
+			CHECK(buf.push(next_in++));
+		}
+		uint8_t out[5];
+		CHECK(buf.peek(out, 5));
+		CHECK(!buf.peek(out, 1, 5));
+		for (int i = 0; i < 5; ++i) {
+			CHECK_EQ(out[i], next_out++);
+		}
+		buf.commit(buf.peek_span(), 5);
+		CHECK(buf.empty());
+	}
+}
+
+static void peek_span_limit(void) {
+	RingBuffer<8> buf;
+	for (uint8_t i = 0; i < 6; ++i) {
+		buf.push(i);
+	}
+	const auto spans = buf.peek_span(4);
+	CHECK_EQ(spans.size(), 4u);
+	// Committing more than was peeked only takes what was.
+	buf.commit(spans, 100);
+	CHECK_EQ(buf.available(), 2u);
+}
+
+// A DMA producer that laps the consumer can't be held back: the overwritten elements are dropped, and the consumer
+// resumes from the oldest one still intact, in order.
+static void dma_overrun_resyncs_the_consumer(void) {
+	RingBuffer<8> buf;
+	uint8_t *storage = buf.storage();
+	for (uint8_t i = 0; i < 6; ++i) {
+		storage[i] = i;
+	}
+	buf.set_head(6);
+
+	// 5 more, 3 past where the consumer is: elements 0 to 2 are overwritten by 8 to 10.
+	for (uint8_t i = 6; i < 11; ++i) {
+		storage[i % 8] = i;
+	}
+	buf.set_head(3);
+	CHECK_EQ(buf.dropped(), 3u);
+	CHECK_EQ(buf.available(), 8u);
+	uint8_t value = 0;
+	for (uint8_t i = 3; i < 11; ++i) {
+		CHECK(buf.pop(value));
+		CHECK_EQ(value, i);
+	}
+	CHECK(buf.empty());
+}
+
+// The producer resyncs the consumer between its peek and its commit: the commit counts from where it peeked, and
+// leaves the intact elements after what it read for the next peek, rather than skipping them uncounted.
+static void commit_after_a_resync(void) {
+	RingBuffer<8> buf;
+	uint8_t *storage = buf.storage();
+	for (uint8_t i = 0; i < 6; ++i) {
+		storage[i] = i;
+	}
+	buf.set_head(6);
+	const auto spans = buf.peek_span(4);
+
+	// 4 more, 2 past where the consumer peeked: the tail moves up to element 2.
+	for (uint8_t i = 6; i < 10; ++i) {
+		storage[i % 8] = i;
+	}
+	buf.set_head(2);
+	CHECK_EQ(buf.dropped(), 2u);
+
+	// Elements 0 to 3 read, 0 and 1 of them garbled: the consumer carries on from 4.
+	buf.commit(spans, 4);
+	CHECK_EQ(buf.available(), 6u);
+	uint8_t value = 0;
+	for (uint8_t i = 4; i < 10; ++i) {
+		CHECK(buf.pop(value));
+		CHECK_EQ(value, i);
+	}
+	CHECK_EQ(buf.dropped(), 2u);
+
+	// And a commit of fewer than the resync skipped doesn't move the tail back over them.
+	for (uint8_t i = 10; i < 14; ++i) {
+		storage[i % 8] = i;
+	}
+	buf.set_head(6);
+	const auto stale = buf.peek_span();
+	for (uint8_t i = 14; i < 20; ++i) {
+		storage[i % 8] = i;
+	}
+	buf.set_head(4);
+	CHECK_EQ(buf.dropped(), 4u);
+	buf.commit(stale, 1);
+	CHECK(buf.pop(value));
+	CHECK_EQ(value, 12);
+}
+
+// Circular DMA into the buffer's storage, publishing its write index the way HAL_UARTEx_RxEventCallback does: at the
+// half and full transfer events, and when the line goes idle after each burst from the host.
+template<size_t N>
+class DmaStream {
+public:
+	explicit DmaStream(RingBuffer<N> &buf) :
+			buf_(buf) {
+	}
+
+	// The host sends a burst of bytes, then the line goes idle. Returns the number of events published.
+	int burst(const uint8_t *data, size_t len) {
+		int events = 0;
+		for (size_t i = 0; i < len; ++i) {
+			buf_.storage()[pos_] = data[i];
+			pos_ = (pos_ + 1) % N;
+			if (pos_ == N / 2) {
+				buf_.set_head(N / 2); // Half transfer.
+				++events;
+			} else if (pos_ == 0) {
+				buf_.set_head(N); // Transfer complete, the DMA starts over.
+				++events;
+			}
+		}
+		buf_.set_head(pos_); // Idle line.
+		return events + 1;
+	}
+
+private:
+	RingBuffer<N> &buf_;
+	size_t pos_ = 0;
+};
+
+// Takes every complete frame out of the buffer, the way Robot::recv_frame does, and hands back the payloads of those
+// that decode and pass their CRC.
+template<size_t N>
+static void receive_frames(RingBuffer<N> &buf,
+		std::vector<std::vector<uint8_t>> &received) {
+	while (true) {
+		const auto spans = buf.peek_span(MAX_ENCODED_FRAME_SIZE);
+		uint8_t frame[MAX_ENCODED_FRAME_SIZE];
+		if (!spans.copy(frame, spans.size()))
+			return;
+		const auto end = static_cast<const uint8_t*>(std::memchr(frame,
+				FRAME_DELIMITER, spans.size()));
+		if (end == nullptr)
+			return; // Not complete yet.
+		const size_t frame_len = end - frame;
+		buf.commit(spans, frame_len + 1);
+
+		const size_t len = cobs_decode(frame, frame_len, frame);
+		CHECK(len >= 1 + FRAME_CRC_SIZE);
+		if (len < 1 + FRAME_CRC_SIZE)
+			continue;
+		const uint16_t crc = frame[len - 2] | (frame[len - 1] << 8);
+		CHECK_EQ(crc16(frame, len - FRAME_CRC_SIZE), crc);
+		received.emplace_back(frame + 1, frame + len - FRAME_CRC_SIZE);
+	}
+}
+
+// Framed commands streamed through the DMA producer, split into bursts that land anywhere relative to the half and
+// full transfer events: every frame comes out exactly once, in order, whichever event published its last byte.
+static void dma_stream_delivers_every_frame_once(void) {
+	static RingBuffer<256> buf;
+	DmaStream<256> dma(buf);
+	std::vector<std::vector<uint8_t>> sent, received;
+	std::vector<uint8_t> wire;
+
+	uint32_t random = 12345;
+	const auto next_random = [&random](uint32_t range) {
+		random = random * 1103515245 + 12345;
+		return (random >> 16) % range;
+	};
+	for (uint32_t seq = 0; seq < 2000; ++seq) {
+		// A sequence number, then up to 40 bytes with zeros among them for the COBS encoding to deal with.
+		std::vector<uint8_t> payload(4 + next_random(41));
+		std::memcpy(payload.data(), &seq, 4);
+		for (size_t i = 4; i < payload.size(); ++i) {
+			payload[i] = next_random(4) == 0 ? 0 : next_random(256);
+		}
+		uint8_t frame[MAX_ENCODED_FRAME_SIZE];
+		const size_t frame_len = frame_encode('p', payload.data(),
+				payload.size(), frame);
+		wire.insert(wire.end(), frame, frame + frame_len);
+		sent.push_back(payload);
+	}
+
+	// Bursts of 1 to 100 bytes, cutting frames anywhere, with the consumer catching up after each one.
+	size_t offset = 0;
+	int events = 0;
+	while (offset < wire.size()) {
+		const size_t len = std::min<size_t>(1 + next_random(100),
+				wire.size() - offset);
+		events += dma.burst(&wire[offset], len);
+		offset += len;
+		receive_frames(buf, received);
+	}
+
+	CHECK(events > 2 * static_cast<int>(wire.size() / 256));
+	CHECK_EQ(received.size(), sent.size());
+	for (size_t i = 0; i < std::min(sent.size(), received.size()); ++i) {
+		CHECK(received[i] == sent[i]);
+	}
+	CHECK(buf.empty());
+	CHECK_EQ(buf.dropped(), 0u);
+}
+
+int main(void) {
+	dma_producer();
+	dma_wraps_around_the_storage();
+	push_pop_round_trip();
+	wraparound();
+	peek_span_limit();
+	dma_overrun_resyncs_the_consumer();
+	commit_after_a_resync();
+	dma_stream_delivers_every_frame_once();
+	return TEST_RESULT();
+}
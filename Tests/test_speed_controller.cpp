@@ -0,0 +1,65 @@
+#include "speed_controller.hpp"
+
+#include "test.hpp"
+
+constexpr float DT = 0.005f;
+constexpr SpeedLoopGains GAINS { 0.5f, 10, 20 };
+
+// On target, the reference goes out as it is.
+static void feed_forward_on_target(void) {
+	SpeedController loop;
+	CHECK_NEAR(loop.step(100, 100, GAINS, DT), 100, 0);
+	CHECK_NEAR(loop.error(), 0, 0);
+}
+
+// A wheel running slow against a steady reference is made up for: proportional at once, then the integral grows.
+static void corrects_a_slow_wheel(void) {
+	SpeedController loop;
+	const float first = loop.step(100, 90, GAINS, DT);
+	CHECK_NEAR(first, 100 + GAINS.kp * 10 + GAINS.ki * 10 * DT, 1e-4);
+	const float second = loop.step(100, 90, GAINS, DT);
+	CHECK(second > first);
+	CHECK_NEAR(loop.error(), 10, 0);
+}
+
+// The correction never goes past its limit, either way.
+static void correction_is_clamped(void) {
+	SpeedController loop;
+	for (int i = 0; i < 1000; ++i) {
+		CHECK(loop.step(100, 0, GAINS, DT) <= 100 + GAINS.max_correction);
+	}
+	for (int i = 0; i < 1000; ++i) {
+		CHECK(loop.step(100, 200, GAINS, DT) >= 100 - GAINS.max_correction);
+	}
+}
+
+// A stalled wheel doesn't wind the integral up: once it catches up, the correction comes off straight away instead of
+// overshooting while the integral unwinds.
+static void no_windup_while_clamped(void) {
+	SpeedController loop;
+	for (int i = 0; i < 2000; ++i) {
+		loop.step(100, 0, GAINS, DT);
+	}
+	// The proportional term alone saturated it, so the integral never started.
+	CHECK_NEAR(loop.step(100, 100, GAINS, DT), 100, 1e-4);
+	CHECK(loop.step(100, 110, GAINS, DT) < 100);
+}
+
+static void reset_starts_over(void) {
+	SpeedController loop;
+	for (int i = 0; i < 100; ++i) {
+		loop.step(100, 90, GAINS, DT);
+	}
+	loop.reset();
+	CHECK_NEAR(loop.error(), 0, 0);
+	CHECK_NEAR(loop.step(100, 100, GAINS, DT), 100, 0);
+}
+
+int main(void) {
+	feed_forward_on_target();
+	corrects_a_slow_wheel();
+	correction_is_clamped();
+	no_windup_while_clamped();
+	reset_starts_over();
+	return TEST_RESULT();
+}
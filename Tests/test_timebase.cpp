@@ -0,0 +1,85 @@
+#include "timebase.hpp"
+
+#include <cmath>
+#include <initializer_list>
+
+#include "constants.hpp"
+#include "test.hpp"
+
+constexpr uint32_t NEAR_WRAP = 0xFFFFFF00u;
+
+static void between_across_the_wrap(void) {
+	CHECK_EQ(us_between(1000, 1500), 500u);
+	CHECK_EQ(us_between(NEAR_WRAP, 0x100), 0x200u);
+	CHECK_EQ(us_between(0xFFFFFFFFu, 0), 1u);
+	CHECK_EQ(us_between(42, 42), 0u);
+}
+
+static void before_across_the_wrap(void) {
+	CHECK(us_before(1000, 1500));
+	CHECK(!us_before(1500, 1000));
+	CHECK(!us_before(1000, 1000));
+	// Just past the wrap is after just before it, though it's the smaller number.
+	CHECK(us_before(NEAR_WRAP, 0x100));
+	CHECK(!us_before(0x100, NEAR_WRAP));
+}
+
+static void midpoint_across_the_wrap(void) {
+	CHECK_EQ(us_midpoint(1000, 2000), 1500u);
+	CHECK_EQ(us_midpoint(NEAR_WRAP, 0x100), 0u);
+	CHECK_EQ(us_midpoint(0xFFFFFFF0u, 0x10), 0u);
+	CHECK_EQ(us_midpoint(NEAR_WRAP, 0xFFFFFF80u), 0xFFFFFF40u);
+}
+
+// Variance of finite difference speed estimates of a wheel turning at a constant 10 rad/s, read by a 12 bit encoder
+// at `rate_hz` with ±20% jitter on when each read happens, and stamped with `resolution_us` resolution.
+static double speed_variance(uint32_t rate_hz, uint32_t resolution_us) {
+	constexpr double SPEED = 10;
+	constexpr double RAD_PER_COUNT = TAU / ENCODER_FULL_RANGE;
+	const double period_us = 1e6 / rate_hz;
+	uint32_t random = 7;
+	double sum = 0, sum_squares = 0;
+	int n = 0;
+	uint32_t last_stamp = 0;
+	double last_angle = 0;
+	for (int i = 0; i < 2000; ++i) {
+		random = random * 1103515245 + 12345;
+		const double jitter = ((random >> 16) % 1000 / 1000.0 - 0.5) * 0.4;
+		const double t_us = 1e6 + (i + jitter) * period_us;
+		// The encoder's count, and the clock as it reads: whole ticks, counted up from the last one.
+		const double angle = std::floor(SPEED * t_us * 1e-6 / RAD_PER_COUNT)
+				* RAD_PER_COUNT;
+		const uint32_t stamp = static_cast<uint32_t>(t_us / resolution_us)
+				* resolution_us;
+		if (i > 0 && stamp != last_stamp) {
+			const double speed = (angle - last_angle)
+					/ (us_between(last_stamp, stamp) * 1e-6);
+			sum += speed;
+			sum_squares += speed * speed;
+			++n;
+		}
+		last_stamp = stamp;
+		last_angle = angle;
+	}
+	const double mean = sum / n;
+	return sum_squares / n - mean * mean;
+}
+
+// Stamped in ms, samples a few ms apart get ±1 ms on their interval; in µs, it's down to the encoder's quantisation.
+static void us_stamps_cut_speed_variance(void) {
+	for (const uint32_t rate_hz : { 100u, 200u, 1000u }) {
+		const double ms = speed_variance(rate_hz, 1000);
+		const double us = speed_variance(rate_hz, 1);
+		std::printf("speed variance at %4u Hz: ms stamps %10.4f, us stamps %8.4f (rad/s)^2\n",
+				static_cast<unsigned>(rate_hz), ms, us);
+		CHECK(us * 4 < ms);
+	}
+}
+
+int main(void) {
+	between_across_the_wrap();
+	before_across_the_wrap();
+	midpoint_across_the_wrap();
+	us_stamps_cut_speed_variance();
+	return TEST_RESULT();
+}
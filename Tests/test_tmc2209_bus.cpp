@@ -0,0 +1,129 @@
+#include "peripherals/tmc2209_bus.hpp"
+
+#include <vector>
+
+#include "test.hpp"
+
+// The UART, played by the test: the sizes of the transfers started, and whether it accepts the next receive.
+static std::vector<uint16_t> tx_sizes, rx_sizes;
+static bool rx_accepts = true;
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef*, const uint8_t*,
+		uint16_t size) {
+	tx_sizes.push_back(size);
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t*,
+		uint16_t size) {
+	if (!rx_accepts)
+		return HAL_ERROR;
+	rx_sizes.push_back(size);
+	huart->RxState = HAL_UART_STATE_BUSY;
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef*) {
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_UART_ReceiverTimeout_Config(UART_HandleTypeDef*,
+		uint32_t) {
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_UART_EnableReceiverTimeout(UART_HandleTypeDef*) {
+	return HAL_OK;
+}
+
+struct Completion {
+	int calls = 0;
+	bool ok = false;
+	uint32_t done_at[TMC2209Bus::MAX_BURST] { };
+	TMC2209Bus *bus = nullptr;
+};
+
+static void on_complete(void *context, bool ok, uint32_t data) {
+	auto *completion = static_cast<Completion*>(context);
+	++completion->calls;
+	completion->ok = ok;
+	for (size_t i = 0; i < TMC2209Bus::MAX_BURST; ++i) {
+		completion->done_at[i] = completion->bus->datagram_done_at(i);
+	}
+}
+
+static void reset_uart(void) {
+	tx_sizes.clear();
+	rx_sizes.clear();
+	rx_accepts = true;
+	dwt_stub.CYCCNT = 0;
+}
+
+// A burst goes out in one transfer, and its echo comes back one datagram at a time, each one timed as it completes.
+static void burst_echo_is_timed_per_datagram(void) {
+	reset_uart();
+	UART_HandleTypeDef huart { };
+	TMC2209Bus bus;
+	bus.init(&huart);
+	Completion completion;
+	completion.bus = &bus;
+
+	const uint8_t addresses[] = { 0, 1, 2 };
+	const uint32_t data[] = { 10, 20, 30 };
+	CHECK(bus.write_burst(addresses, 0x22, data, 3, on_complete, &completion));
+	CHECK_EQ(tx_sizes.size(), 1u);
+	CHECK_EQ(tx_sizes[0], 3 * TMC_WRITE_DATAGRAM_SIZE);
+	CHECK_EQ(rx_sizes.size(), 1u);
+	CHECK_EQ(rx_sizes[0], TMC_WRITE_DATAGRAM_SIZE);
+
+	bus.on_tx_complete();
+	for (uint32_t i = 0; i < 3; ++i) {
+		dwt_stub.CYCCNT = 1000 * (i + 1);
+		CHECK_EQ(completion.calls, 0);
+		bus.on_rx_complete();
+	}
+	CHECK_EQ(rx_sizes.size(), 3u);
+	CHECK_EQ(completion.calls, 1);
+	CHECK(completion.ok);
+	CHECK_EQ(completion.done_at[0], 1000u);
+	CHECK_EQ(completion.done_at[2], 3000u);
+	CHECK(bus.idle());
+	CHECK_EQ(bus.writes_sent(1), 1u);
+}
+
+// If the receive for the next datagram's echo can't be started, the burst fails rather than hanging.
+static void burst_fails_if_the_echo_is_lost(void) {
+	reset_uart();
+	UART_HandleTypeDef huart { };
+	TMC2209Bus bus;
+	bus.init(&huart);
+	Completion completion;
+	completion.bus = &bus;
+
+	const uint8_t addresses[] = { 0, 1 };
+	const uint32_t data[] = { 10, 20 };
+	CHECK(bus.write_burst(addresses, 0x22, data, 2, on_complete, &completion));
+	bus.on_tx_complete();
+	rx_accepts = false;
+	bus.on_rx_complete();
+	CHECK_EQ(completion.calls, 1);
+	CHECK(!completion.ok);
+	CHECK(bus.idle());
+}
+
+// Reads take their echo and reply in one go.
+static void read_is_received_whole(void) {
+	reset_uart();
+	UART_HandleTypeDef huart { };
+	TMC2209Bus bus;
+	bus.init(&huart);
+	Completion completion;
+	completion.bus = &bus;
+
+	CHECK(bus.read(0, 0x02, on_complete, &completion));
+	CHECK_EQ(rx_sizes.size(), 1u);
+	CHECK_EQ(rx_sizes[0], TMC_READ_REQUEST_SIZE + TMC_REPLY_SIZE);
+}
+
+int main(void) {
+	burst_echo_is_timed_per_datagram();
+	burst_fails_if_the_echo_is_lost();
+	read_is_received_whole();
+	return TEST_RESULT();
+}
@@ -0,0 +1,81 @@
+#include "peripherals/tmc2209_datagram.hpp"
+
+#include <cstdlib>
+
+#include "test.hpp"
+
+// The datasheet's bit by bit CRC, for the table driven one to be checked against.
+static uint8_t datasheet_crc8(const uint8_t *data, size_t len) {
+	uint8_t crc = 0;
+	for (size_t i = 0; i < len; ++i) {
+		uint8_t byte = data[i];
+		for (uint8_t bit = 0; bit < 8; ++bit) {
+			if ((crc >> 7) ^ (byte & 0x01)) {
+				crc = (crc << 1) ^ 0x07;
+			} else {
+				crc = crc << 1;
+			}
+			byte >>= 1;
+		}
+	}
+	return crc;
+}
+
+static void crc8_vectors(void) {
+	// Reading GCONF from serial address 0, as commonly seen on the wire.
+	const uint8_t gconf_read[] = { 0x05, 0x00, 0x00 };
+	CHECK_EQ(tmc_crc8(gconf_read, sizeof(gconf_read)), 0x48);
+	CHECK_EQ(datasheet_crc8(gconf_read, sizeof(gconf_read)), 0x48);
+	CHECK_EQ(tmc_crc8(nullptr, 0), 0);
+	static_assert(tmc_reverse_bits(0x01) == 0x80 && tmc_reverse_bits(0xC4) == 0x23);
+}
+
+static void crc8_matches_datasheet(void) {
+	std::srand(1);
+	for (int n = 0; n < 10000; ++n) {
+		uint8_t data[TMC_WRITE_DATAGRAM_SIZE];
+		const size_t len = 1 + std::rand() % sizeof(data);
+		for (size_t i = 0; i < len; ++i) {
+			data[i] = std::rand();
+		}
+		CHECK_EQ(tmc_crc8(data, len), datasheet_crc8(data, len));
+	}
+}
+
+static void write_datagram(void) {
+	uint8_t datagram[TMC_WRITE_DATAGRAM_SIZE];
+	tmc_build_write(datagram, 2, 0x22, 0x12345678);
+	const uint8_t expected[] = { TMC_SYNC, 2, 0x22 | TMC_WRITE_BIT, 0x12, 0x34,
+			0x56, 0x78 };
+	for (size_t i = 0; i < sizeof(expected); ++i) {
+		CHECK_EQ(datagram[i], expected[i]);
+	}
+	CHECK_EQ(datagram[7], datasheet_crc8(datagram, 7));
+}
+
+static void read_request_and_reply(void) {
+	uint8_t request[TMC_READ_REQUEST_SIZE];
+	tmc_build_read_request(request, 0, 0x00);
+	CHECK_EQ(request[3], 0x48);
+
+	// A reply is a write datagram to the master's address.
+	uint8_t reply[TMC_REPLY_SIZE];
+	tmc_build_write(reply, TMC_REPLY_ADDRESS, 0x02, 0xCAFE);
+	reply[2] = 0x02; // Replies carry the register address without the write bit.
+	reply[7] = tmc_crc8(reply, 7);
+	uint32_t data = 0;
+	CHECK(tmc_parse_reply(reply, 0x02, data));
+	CHECK_EQ(data, 0xCAFEu);
+
+	CHECK(!tmc_parse_reply(reply, 0x06, data)); // Answers another register.
+	reply[5] ^= 0x10;
+	CHECK(!tmc_parse_reply(reply, 0x02, data)); // Corrupted.
+}
+
+int main(void) {
+	crc8_vectors();
+	crc8_matches_datasheet();
+	write_datagram();
+	read_request_and_reply();
+	return TEST_RESULT();
+}
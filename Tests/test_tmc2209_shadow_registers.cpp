@@ -0,0 +1,133 @@
+#include "peripherals/TMC2209.hpp"
+
+#include <vector>
+
+#include "test.hpp"
+
+// The bus, played by the test: write datagrams are recorded instead of sent, reads are left unanswered.
+struct Datagram {
+	uint8_t serial_address;
+	uint8_t register_address;
+	uint32_t data;
+};
+static std::vector<Datagram> sent;
+
+void TMC2209Bus::init(UART_HandleTypeDef*) {
+}
+bool TMC2209Bus::write(uint8_t serial_address, uint8_t register_address,
+		uint32_t data) {
+	sent.push_back( { serial_address, register_address, data });
+	return true;
+}
+bool TMC2209Bus::read(uint8_t, uint8_t, Callback, void*) {
+	return true;
+}
+bool TMC2209Bus::write_burst(const uint8_t *serial_addresses,
+		uint8_t register_address, const uint32_t *data, size_t count,
+		Callback callback, void *context) {
+	for (size_t i = 0; i < count; ++i) {
+		write(serial_addresses[i], register_address, data[i]);
+	}
+	if (callback != nullptr) {
+		callback(context, true, 0);
+	}
+	return true;
+}
+void HAL_GPIO_WritePin(GPIO_TypeDef*, uint16_t, GPIO_PinState) {
+}
+
+constexpr uint8_t IHOLD_IRUN = tmc2209_reg::IHOLD_IRUN::ADDRESS;
+constexpr uint8_t CHOPCONF = tmc2209_reg::CHOPCONF::ADDRESS;
+constexpr uint8_t VACTUAL = TMC2209::ADDRESS_VACTUAL;
+
+static size_t count_sent(uint8_t register_address) {
+	size_t count = 0;
+	for (const auto &datagram : sent) {
+		count += datagram.register_address == register_address;
+	}
+	return count;
+}
+
+// Setters only touch the shadow registers: several of them on one register go out as one datagram, and nothing
+// goes out for a register set to the value it already has.
+static void writes_are_coalesced(void) {
+	TMC2209Bus bus;
+	TMC2209 driver;
+	driver.attach(&bus, 115200, TMC2209::SERIAL_ADDRESS_1);
+	sent.clear();
+
+	driver.setRunCurrent(50);
+	driver.setHoldCurrent(20);
+	driver.moveAtVelocity(100);
+	driver.moveAtVelocity(200);
+	CHECK(sent.empty());
+	driver.flush();
+	CHECK_EQ(sent.size(), 2u);
+	CHECK_EQ(count_sent(IHOLD_IRUN), 1u);
+	CHECK_EQ(count_sent(VACTUAL), 1u);
+	CHECK_EQ(sent.back().data, 200u);
+	CHECK_EQ(sent.back().serial_address, TMC2209::SERIAL_ADDRESS_1);
+
+	sent.clear();
+	driver.setRunCurrent(50);
+	driver.moveAtVelocity(200);
+	driver.flush();
+	CHECK(sent.empty());
+}
+
+// Configuration goes out before CHOPCONF, which enables the driver, and VACTUAL last.
+static void flush_order(void) {
+	TMC2209Bus bus;
+	TMC2209 driver;
+	driver.attach(&bus);
+	sent.clear();
+
+	driver.moveAtVelocity(-300);
+	driver.enable();
+	driver.setRunCurrent(80);
+	driver.flush();
+	CHECK_EQ(sent.size(), 3u);
+	CHECK_EQ(sent[0].register_address, IHOLD_IRUN);
+	CHECK_EQ(sent[1].register_address, CHOPCONF);
+	CHECK_EQ(sent[2].register_address, VACTUAL);
+}
+
+static void repetitions_and_invalidation(void) {
+	TMC2209Bus bus;
+	TMC2209 driver;
+	driver.attach(&bus);
+	driver.setRunCurrent(30);
+	driver.moveAtVelocity(10);
+	sent.clear();
+	driver.flush(3);
+	CHECK_EQ(sent.size(), 6u);
+
+	// After the driver lost power, everything that was ever written goes out again.
+	sent.clear();
+	driver.invalidateShadowRegisters();
+	driver.flush();
+	CHECK_EQ(sent.size(), 2u);
+}
+
+// Once VACTUAL is delegated, flush leaves it to its new owner.
+static void delegated_velocity(void) {
+	TMC2209Bus bus;
+	TMC2209 driver;
+	driver.attach(&bus);
+	driver.delegateVelocity([](void*, uint8_t) {
+	}, nullptr);
+	sent.clear();
+	driver.moveAtVelocity(500);
+	driver.setRunCurrent(40);
+	driver.flush();
+	CHECK_EQ(count_sent(VACTUAL), 0u);
+	CHECK_EQ(count_sent(IHOLD_IRUN), 1u);
+}
+
+int main(void) {
+	writes_are_coalesced();
+	flush_order();
+	repetitions_and_invalidation();
+	delegated_velocity();
+	return TEST_RESULT();
+}
@@ -0,0 +1,115 @@
+#include "tx_queue.hpp"
+
+#include <vector>
+
+#include "test.hpp"
+
+// The UART: transfers it accepted, in order, and whether it accepts the next one.
+static std::vector<std::vector<uint8_t>> transfers;
+static bool uart_accepts = true;
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef*,
+		const uint8_t *data, uint16_t size) {
+	if (!uart_accepts)
+		return HAL_BUSY;
+	transfers.emplace_back(data, data + size);
+	return HAL_OK;
+}
+
+static void reset_uart(void) {
+	transfers.clear();
+	uart_accepts = true;
+}
+
+static bool send(TxQueue &queue, uint8_t tag, TxQueue::Kind kind) {
+	return queue.send(&tag, 1, kind);
+}
+
+static void fifo_order(void) {
+	reset_uart();
+	UART_HandleTypeDef huart { };
+	TxQueue queue;
+	queue.init(&huart);
+	for (uint8_t i = 0; i < 4; ++i) {
+		CHECK(send(queue, i, TxQueue::Kind::REPLY));
+	}
+	// One transfer at a time, the next started from the completion.
+	CHECK_EQ(transfers.size(), 1u);
+	for (int i = 0; i < 4; ++i) {
+		queue.on_tx_complete();
+	}
+	CHECK_EQ(transfers.size(), 4u);
+	for (uint8_t i = 0; i < 4; ++i) {
+		CHECK_EQ(transfers[i][0], i);
+	}
+}
+
+// With the queue full, the oldest telemetry frame waiting makes way for the new frame, whichever kind it is.
+static void oldest_telemetry_is_evicted(void) {
+	reset_uart();
+	UART_HandleTypeDef huart { };
+	TxQueue queue;
+	queue.init(&huart);
+	CHECK(send(queue, 0, TxQueue::Kind::REPLY)); // On the wire.
+	for (uint8_t i = 1; i < USB_TX_QUEUE_LENGTH; ++i) {
+		CHECK(send(queue, 100 + i, TxQueue::Kind::TELEMETRY));
+	}
+	CHECK(send(queue, 200, TxQueue::Kind::TELEMETRY));
+	CHECK_EQ(queue.dropped_telemetry(), 1u);
+	CHECK(send(queue, 1, TxQueue::Kind::REPLY));
+	CHECK_EQ(queue.dropped_telemetry(), 2u);
+
+	for (size_t i = 0; i < USB_TX_QUEUE_LENGTH; ++i) {
+		queue.on_tx_complete();
+	}
+	CHECK_EQ(transfers.size(), size_t(USB_TX_QUEUE_LENGTH));
+	CHECK_EQ(transfers[1][0], 103); // 101 and 102 were evicted.
+	CHECK_EQ(transfers[USB_TX_QUEUE_LENGTH - 2][0], 200);
+	CHECK_EQ(transfers[USB_TX_QUEUE_LENGTH - 1][0], 1);
+}
+
+// A reply the UART refuses to send stays queued, ahead of what came after it, until it goes out.
+static void refused_reply_is_retried(void) {
+	reset_uart();
+	UART_HandleTypeDef huart { };
+	TxQueue queue;
+	queue.init(&huart);
+	uart_accepts = false;
+	CHECK(send(queue, 1, TxQueue::Kind::REPLY));
+	CHECK(send(queue, 2, TxQueue::Kind::TELEMETRY));
+	queue.poll();
+	CHECK(transfers.empty());
+	CHECK_EQ(queue.failed_transfers(), 3u);
+	CHECK_EQ(queue.dropped_telemetry(), 0u);
+
+	uart_accepts = true;
+	queue.poll();
+	CHECK_EQ(transfers.size(), 1u);
+	CHECK_EQ(transfers[0][0], 1);
+	queue.on_tx_complete();
+	CHECK_EQ(transfers.size(), 2u);
+	CHECK_EQ(transfers[1][0], 2);
+}
+
+// Telemetry the UART refuses to send is dropped instead.
+static void refused_telemetry_is_dropped(void) {
+	reset_uart();
+	UART_HandleTypeDef huart { };
+	TxQueue queue;
+	queue.init(&huart);
+	uart_accepts = false;
+	CHECK(send(queue, 1, TxQueue::Kind::TELEMETRY));
+	CHECK_EQ(queue.failed_transfers(), 1u);
+	CHECK_EQ(queue.dropped_telemetry(), 1u);
+	uart_accepts = true;
+	queue.poll();
+	CHECK(transfers.empty());
+}
+
+int main(void) {
+	fifo_order();
+	oldest_telemetry_is_evicted();
+	refused_reply_is_retried();
+	refused_telemetry_is_dropped();
+	return TEST_RESULT();
+}
@@ -0,0 +1,97 @@
+#include "velocity_ramp.hpp"
+
+#include <initializer_list>
+
+#include "test.hpp"
+
+constexpr float DT = 0.005f;
+
+// No acceleration limit: straight to the target.
+static void no_limit_is_a_step(void) {
+	VelocityRamp ramp;
+	const RampLimits limits { 0, 0 };
+	CHECK_NEAR(ramp.step(100, limits, DT), 100, 0);
+	CHECK_NEAR(ramp.step(-40, limits, DT), -40, 0);
+}
+
+// Acceleration limit only: a trapezoid, each step at most a * dt, and it stops on the target.
+static void acceleration_is_limited(void) {
+	VelocityRamp ramp;
+	const RampLimits limits { 1000, 0 };
+	float last = 0;
+	int steps = 0;
+	while (ramp.velocity() != 100 && steps < 1000) {
+		const float velocity = ramp.step(100, limits, DT);
+		CHECK(velocity - last <= limits.acceleration * DT + 1e-3f);
+		CHECK(velocity <= 100);
+		last = velocity;
+		++steps;
+	}
+	CHECK_EQ(steps, 20);
+	CHECK_NEAR(ramp.step(100, limits, DT), 100, 0);
+}
+
+// With a jerk limit, the acceleration changes by at most j * dt per step, stays within its limit, and the velocity
+// lands on the target without overshooting it, either way.
+static void jerk_is_limited_without_overshoot(void) {
+	const RampLimits limits { 1000, 20000 };
+	for (const float target : { 150.0f, -150.0f, 3.0f }) {
+		VelocityRamp ramp;
+		float last_velocity = 0, last_acceleration = 0;
+		int steps = 0;
+		while (ramp.velocity() != target && steps < 10000) {
+			const float velocity = ramp.step(target, limits, DT);
+			const float acceleration = (velocity - last_velocity) / DT;
+			CHECK(std::fabs(acceleration) <= limits.acceleration + 1e-2f);
+			// Landing snaps onto the target, which may take the acceleration down in one step.
+			if (velocity != target) {
+				CHECK(std::fabs(acceleration - last_acceleration)
+						<= limits.jerk * DT + 1e-2f);
+			}
+			CHECK(std::fabs(velocity) <= std::fabs(target));
+			last_velocity = velocity;
+			last_acceleration = acceleration;
+			++steps;
+		}
+		CHECK(steps < 10000);
+		CHECK_NEAR(ramp.step(target, limits, DT), target, 0);
+	}
+}
+
+// A target that reverses mid-ramp is followed back without the velocity jumping.
+static void target_reversal_is_smooth(void) {
+	VelocityRamp ramp;
+	const RampLimits limits { 1000, 20000 };
+	for (int i = 0; i < 10; ++i) {
+		ramp.step(200, limits, DT);
+	}
+	float last = ramp.velocity();
+	for (int i = 0; i < 200; ++i) {
+		const float velocity = ramp.step(-200, limits, DT);
+		CHECK(std::fabs(velocity - last) <= limits.acceleration * DT + 1e-2f);
+		last = velocity;
+	}
+	CHECK_NEAR(ramp.velocity(), -200, 0);
+}
+
+static void reset_stops_on_the_spot(void) {
+	VelocityRamp ramp;
+	const RampLimits limits { 1000, 20000 };
+	for (int i = 0; i < 20; ++i) {
+		ramp.step(200, limits, DT);
+	}
+	CHECK(ramp.velocity() > 0);
+	ramp.reset();
+	CHECK_NEAR(ramp.velocity(), 0, 0);
+	// And starts the next ramp from rest, with no acceleration left over.
+	CHECK(ramp.step(200, limits, DT) <= limits.jerk * DT * DT + 1e-3f);
+}
+
+int main(void) {
+	no_limit_is_a_step();
+	acceleration_is_limited();
+	jerk_is_limited_without_overshoot();
+	target_reversal_is_smooth();
+	reset_stops_on_the_spot();
+	return TEST_RESULT();
+}
@@ -0,0 +1,106 @@
+#include "wheel_state_estimator.hpp"
+
+#include <cmath>
+
+#include "test.hpp"
+
+constexpr double RAD_PER_COUNT = TAU / ENCODER_FULL_RANGE;
+constexpr uint32_t SAMPLE_US = 5000;
+
+// Wheels turning at constant speeds, as the encoders see them: quantised, and wrapped to a turn.
+struct Wheels {
+	double angle[WHEEL_COUNT];
+	double speed[WHEEL_COUNT];
+	uint32_t time_us;
+
+	void sample(uint16_t *counts, uint32_t *timestamps) const {
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			const double turns = angle[i] / TAU;
+			const double wrapped = (turns - std::floor(turns)) * TAU;
+			counts[i] = static_cast<uint16_t>(wrapped / RAD_PER_COUNT)
+					% ENCODER_FULL_RANGE;
+			timestamps[i] = time_us;
+		}
+	}
+	void advance(uint32_t us) {
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			angle[i] += speed[i] * us * 1e-6;
+		}
+		time_us += us;
+	}
+};
+
+static void run(WheelStateEstimator &estimator, Wheels &wheels, int samples,
+		const float *commanded = nullptr) {
+	uint16_t counts[WHEEL_COUNT];
+	uint32_t timestamps[WHEEL_COUNT];
+	for (int n = 0; n < samples; ++n) {
+		wheels.sample(counts, timestamps);
+		estimator.update(counts, timestamps, commanded);
+		wheels.advance(SAMPLE_US);
+	}
+}
+
+// From nothing known about the speeds, the estimates settle on them, both ways round and across the angle's wrap at
+// 0/2π. The timestamps start just short of their own wrap, too. A count is worth 0.3 rad/s over one sample, so single
+// estimates still wander a little with the quantisation, but not on average.
+static void converges_to_constant_speeds(void) {
+	WheelStateEstimator estimator;
+	Wheels wheels { { 0.1, 6.2, 3.0 }, { 12, -7, 0.5 }, 0xFFFFF000u };
+	run(estimator, wheels, 200);
+	double mean[WHEEL_COUNT] { };
+	constexpr int AVERAGED = 400;
+	for (int n = 0; n < AVERAGED; ++n) {
+		run(estimator, wheels, 1);
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			CHECK_NEAR(estimator.speed(i), wheels.speed[i], 0.2);
+			CHECK(estimator.angle(i) >= 0);
+			CHECK(estimator.angle(i) < TAU);
+			mean[i] += estimator.speed(i) / AVERAGED;
+		}
+	}
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		CHECK_NEAR(mean[i], wheels.speed[i], 0.02);
+	}
+}
+
+// The angle estimate follows the wheel around the wrap instead of taking the long way back.
+static void angle_follows_across_the_wrap(void) {
+	WheelStateEstimator estimator;
+	Wheels wheels { { 6.0, 0.3, 1.0 }, { 10, -10, 0 }, 0 };
+	for (int n = 0; n < 200; ++n) {
+		run(estimator, wheels, 1);
+		for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+			const double last = wheels.angle[i] - wheels.speed[i] * SAMPLE_US * 1e-6;
+			const double error = std::remainder(estimator.angle(i) - last, TAU);
+			CHECK_NEAR(error, 0, 0.05);
+		}
+	}
+}
+
+// Samples too far apart can't tell how many turns were made in between: the estimate starts over from the
+// measurement, with the commanded speed, rather than fitting a speed to the wrong number of turns.
+static void gap_restarts_from_the_measurement(void) {
+	WheelStateEstimator estimator;
+	Wheels wheels { { 1.0, 2.0, 3.0 }, { 5, 5, 5 }, 1000 };
+	run(estimator, wheels, 200);
+	CHECK_NEAR(estimator.speed(0), 5, 0.2);
+
+	wheels.advance(ENCODER_MAX_SAMPLE_GAP_US);
+	uint16_t counts[WHEEL_COUNT];
+	uint32_t timestamps[WHEEL_COUNT];
+	wheels.sample(counts, timestamps);
+	const float commanded[WHEEL_COUNT] = { 2, 2, 2 };
+	estimator.update(counts, timestamps, commanded);
+	for (uint8_t i = 0; i < WHEEL_COUNT; ++i) {
+		CHECK_NEAR(estimator.speed(i), 2, 0);
+		CHECK_NEAR(estimator.angle(i), counts[i] * RAD_PER_COUNT, 1e-5);
+	}
+}
+
+int main(void) {
+	converges_to_constant_speeds();
+	angle_follows_across_the_wrap();
+	gap_restarts_from_the_measurement();
+	return TEST_RESULT();
+}